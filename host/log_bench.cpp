@@ -0,0 +1,497 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// Hot path benchmark for the host build. Each case logs the same message
+// repeatedly while a second thread runs LogTask() into a byte-counting sink,
+// and reports:
+//  - ns/call   - average time spent inside LOG() for accepted messages
+//  - msgs/s    - messages delivered to the sink per second of wall time
+//  - bytes/s   - bytes delivered to the sink per second of wall time
+// Messages rejected with eBUSY are retried, the retry count is reported as well.
+//
+// Contention mode (-c) instead runs several producer threads at a fixed rate
+// against a sink of limited speed, each message is tried once. It reports the
+// p50/p99/p99.9/max latency of all LOG() calls, the share of calls that
+// returned eBUSY and the share of messages that never reached the sink -
+// the data for sizing LOG_BUFFER_SIZE against a given sink and load.
+//
+// usage: log_bench [messages per case]
+//        log_bench -c [-t threads] [-r msgs/s per thread, 0 = flat out]
+//                     [-s message bytes] [-k sink bytes/s, 0 = unlimited]
+//                     [-d seconds]
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             // fopencookie()
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <globals.h>
+#include "logger.h"
+#include "log_sink_stdio.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define CMP_NAME            "Bench"
+#define DEFAULT_MESSAGES    200000
+#define NS_PER_S            1000000000ULL
+
+// Latency histogram: exact below HIST_SUB_COUNT ns, above that HIST_SUB_COUNT
+// buckets per power of two - ~6% resolution over the whole 64-bit range
+#define HIST_SUB_BITS       4
+#define HIST_SUB_COUNT      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS        ((64 - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)
+
+#define MAX_PRODUCERS       64
+#define DEFAULT_THREADS     4
+#define DEFAULT_RATE        10000
+#define DEFAULT_SIZE        64
+#define DEFAULT_SECONDS     2
+
+//==============================================================================
+//  Local types
+//==============================================================================
+typedef eStatus (*BenchFn)(const uint32_t i);
+
+typedef struct _BenchCase
+{
+    const char *            Name;
+    BenchFn                 Run;
+} BenchCase;
+
+typedef struct _ContentionConfig
+{
+    uint32_t                Threads;
+    uint32_t                Rate;           // messages/s per thread, 0 - no pacing
+    uint32_t                Size;           // payload bytes per message
+    uint32_t                Seconds;
+} ContentionConfig;
+
+typedef struct _Producer
+{
+    pthread_t               Thread;
+    const ContentionConfig* Config;
+    uint64_t                Hist[HIST_BUCKETS];
+    uint64_t                MaxNs;
+    uint64_t                Attempts;
+    uint64_t                Busy;
+} Producer;
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static volatile bool        stopConsumer = false;
+static volatile uint64_t    sinkBytes = 0;
+static volatile uint64_t    sinkLastWriteNs = 0;
+static uint64_t             sinkBytesPerSec = 0;    // 0 - unlimited
+static volatile bool        stopProducers = false;
+
+static char                 payload[256];
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static uint64_t nowNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * NS_PER_S) + (uint64_t)now.tv_nsec;
+}
+
+static void sleepUntil(const uint64_t deadlineNs)
+{
+    struct timespec deadline;
+
+    deadline.tv_sec = (time_t)(deadlineNs / NS_PER_S);
+    deadline.tv_nsec = (long)(deadlineNs % NS_PER_S);
+    while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL))
+    {
+    }
+}
+
+// fopencookie() write callback - counts what reaches the sink and discards it,
+// taking as long as a sink of sinkBytesPerSec would. Only LogTask() calls it
+static ssize_t countingWrite(void * cookie, const char * buffer, size_t size)
+{
+    (void)cookie;
+    (void)buffer;
+
+    if (0 != sinkBytesPerSec)
+    {
+        sleepUntil(nowNs() + ((size * NS_PER_S) / sinkBytesPerSec));
+    }
+
+    __atomic_store_n(&sinkLastWriteNs, nowNs(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&sinkBytes, size, __ATOMIC_RELAXED);
+
+    return (ssize_t)size;
+}
+
+static void * consumerThread(void * arg)
+{
+    (void)arg;
+
+    while (!stopConsumer)
+    {
+        LogTask();
+    }
+
+    return NULL;
+}
+
+static eStatus benchLiteral(const uint32_t i)
+{
+    (void)i;
+    return LOG(eLogInfo, "System initialized, entering main loop");
+}
+
+static eStatus benchIntegers(const uint32_t i)
+{
+    return LOG(eLogInfo, "rx=%u tx=%u err=%d", i, i * 3, -(int)(i & 0xff));
+}
+
+static eStatus benchHex(const uint32_t i)
+{
+    return LOG(eLogDebug, "reg 0x%08X = 0x%04x", i, i & 0xffff);
+}
+
+static eStatus benchStrings(const uint32_t i)
+{
+    return LOG(eLogInfo, "state %s -> %s", (i & 1) ? "IDLE" : "RUNNING", (i & 1) ? "RUNNING" : "IDLE");
+}
+
+static eStatus benchFloat(const uint32_t i)
+{
+    return LOG(eLogInfo, "temperature %.2f C, humidity %.1f%%", 20.0 + (i % 100) / 10.0, 45.5);
+}
+
+static eStatus benchMixed(const uint32_t i)
+{
+    return LOG(eLogWarn, "%s: retry %d of %d after %u ms (%.3f s total)", "wifi", i % 5, 5, i % 1000, i / 1000.0);
+}
+
+static const BenchCase benchCases[] = {
+    { "literal",    benchLiteral },
+    { "integers",   benchIntegers },
+    { "hex",        benchHex },
+    { "strings",    benchStrings },
+    { "float",      benchFloat },
+    { "mixed",      benchMixed },
+};
+
+// Average cost of the nowNs() pair wrapped around each LOG() call
+static uint64_t clockOverheadNs(void)
+{
+    const uint32_t rounds = 100000;
+    const uint64_t start = nowNs();
+
+    for (uint32_t i = 0; i < rounds; i++)
+    {
+        (void)nowNs();
+    }
+
+    return (nowNs() - start) / rounds;
+}
+
+// Waits until LogTask() has written everything logged so far
+static void waitDrained(void)
+{
+    uint64_t bytes;
+
+    do
+    {
+        bytes = sinkBytes;
+        usleep(100000);     // longer than LOG_BATCH_MAX_LATENCY
+    } while (bytes != sinkBytes);
+}
+
+static void runCase(const BenchCase * const bench, const uint32_t messages, const uint64_t clockNs)
+{
+    uint64_t insideNs = 0;
+    uint64_t retries = 0;
+
+    waitDrained();
+    const uint64_t startBytes = sinkBytes;
+    const uint64_t start = nowNs();
+
+    for (uint32_t i = 0; i < messages; i++)
+    {
+        eStatus status;
+
+        do
+        {
+            const uint64_t callStart = nowNs();
+            status = bench->Run(i);
+            const uint64_t callEnd = nowNs();
+
+            if (eBUSY == status)
+            {
+                retries++;
+                sched_yield();
+            }
+            else
+            {
+                insideNs += callEnd - callStart - clockNs;
+            }
+        } while (eBUSY == status);
+    }
+
+    waitDrained();
+    const double seconds = (double)(sinkLastWriteNs - start) / NS_PER_S;
+    const uint64_t bytes = sinkBytes - startBytes;
+
+    printf("%-10s %10.1f %12.0f %14.0f %10.1f %10llu\n", bench->Name,
+            (double)insideNs / messages,
+            messages / seconds,
+            bytes / seconds,
+            (double)bytes / messages,
+            (unsigned long long)retries);
+}
+
+static size_t histBucket(const uint64_t ns)
+{
+    size_t retVal = (size_t)ns;
+
+    if (ns >= HIST_SUB_COUNT)
+    {
+        const unsigned msb = 63 - __builtin_clzll(ns);
+        const unsigned shift = msb - HIST_SUB_BITS;
+        retVal = ((msb - HIST_SUB_BITS + 1) * HIST_SUB_COUNT) + ((ns >> shift) & (HIST_SUB_COUNT - 1));
+    }
+
+    return retVal;
+}
+
+// Lowest value that falls into the bucket
+static uint64_t histValue(const size_t bucket)
+{
+    uint64_t retVal = bucket;
+
+    if (bucket >= HIST_SUB_COUNT)
+    {
+        const unsigned shift = (bucket / HIST_SUB_COUNT) - 1;
+        retVal = (uint64_t)(HIST_SUB_COUNT + (bucket % HIST_SUB_COUNT)) << shift;
+    }
+
+    return retVal;
+}
+
+static uint64_t histPercentile(const uint64_t * const hist, const uint64_t count, const double percentile)
+{
+    const uint64_t rank = (uint64_t)((count * percentile) / 100.0);
+    uint64_t seen = 0;
+    size_t i = 0;
+
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += hist[i];
+        if (seen > rank)
+        {
+            break;
+        }
+    }
+
+    return histValue(MIN(i, (size_t)(HIST_BUCKETS - 1)));
+}
+
+static void * producerThread(void * arg)
+{
+    Producer * const producer = (Producer *)arg;
+    const ContentionConfig * const config = producer->Config;
+    const uint64_t periodNs = (0 != config->Rate) ? (NS_PER_S / config->Rate) : 0;
+    uint64_t next = nowNs();
+
+    while (!stopProducers)
+    {
+        if (0 != periodNs)
+        {
+            next += periodNs;
+            sleepUntil(next);
+        }
+
+        const uint64_t callStart = nowNs();
+        const eStatus status = LOG(eLogInfo, "%.*s", (int)config->Size, payload);
+        const uint64_t ns = nowNs() - callStart;
+
+        producer->Hist[histBucket(ns)]++;
+        producer->MaxNs = MAX(producer->MaxNs, ns);
+        producer->Attempts++;
+        if (eBUSY == status)
+        {
+            producer->Busy++;
+        }
+    }
+
+    return NULL;
+}
+
+static int runContention(const ContentionConfig * const config)
+{
+    Producer * const producers = (Producer *)calloc(config->Threads, sizeof(Producer));
+    uint64_t * const hist = (uint64_t *)calloc(HIST_BUCKETS, sizeof(uint64_t));
+    uint64_t attempts = 0;
+    uint64_t busy = 0;
+    uint64_t maxNs = 0;
+
+    if ((NULL == producers) || (NULL == hist))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    memset(payload, 'x', sizeof(payload));
+
+    printf("%u producers, %u msgs/s each%s, %u byte payload, sink %llu bytes/s%s, %u s\n\n",
+            config->Threads, config->Rate, (0 == config->Rate) ? " (unpaced)" : "", config->Size,
+            (unsigned long long)sinkBytesPerSec, (0 == sinkBytesPerSec) ? " (unlimited)" : "", config->Seconds);
+
+    waitDrained();
+    LogResetStats();
+
+    for (uint32_t i = 0; i < config->Threads; i++)
+    {
+        producers[i].Config = config;
+        pthread_create(&producers[i].Thread, NULL, producerThread, &producers[i]);
+    }
+
+    sleep(config->Seconds);
+    stopProducers = true;
+
+    for (uint32_t i = 0; i < config->Threads; i++)
+    {
+        pthread_join(producers[i].Thread, NULL);
+        for (size_t b = 0; b < HIST_BUCKETS; b++)
+        {
+            hist[b] += producers[i].Hist[b];
+        }
+        attempts += producers[i].Attempts;
+        busy += producers[i].Busy;
+        maxNs = MAX(maxNs, producers[i].MaxNs);
+    }
+
+    waitDrained();
+    LogStats stats;
+    LogGetStats(&stats);
+
+    printf("calls      %12llu\n", (unsigned long long)attempts);
+    printf("p50        %12llu ns\n", (unsigned long long)histPercentile(hist, attempts, 50.0));
+    printf("p99        %12llu ns\n", (unsigned long long)histPercentile(hist, attempts, 99.0));
+    printf("p99.9      %12llu ns\n", (unsigned long long)histPercentile(hist, attempts, 99.9));
+    printf("max        %12llu ns\n", (unsigned long long)maxNs);
+    printf("eBUSY      %12.3f %%\n", (0 != attempts) ? (100.0 * busy / attempts) : 0.0);
+    printf("dropped    %12.3f %%  (%u of %llu, evicted %u)\n",
+            (0 != attempts) ? (100.0 * stats.MessagesDropped / attempts) : 0.0,
+            (unsigned)stats.MessagesDropped, (unsigned long long)attempts, (unsigned)stats.MessagesEvicted);
+    printf("high water %12u of %u bytes\n", (unsigned)stats.BufferHighWater, (unsigned)stats.BufferSize);
+
+    free(hist);
+    free(producers);
+
+    return 0;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+int main(int argc, char ** argv)
+{
+    ContentionConfig config = { DEFAULT_THREADS, DEFAULT_RATE, DEFAULT_SIZE, DEFAULT_SECONDS };
+    bool contention = false;
+    uint32_t messages = DEFAULT_MESSAGES;
+    cookie_io_functions_t functions = { NULL, countingWrite, NULL, NULL };
+    FILE * const sink = fopencookie(NULL, "w", functions);
+    pthread_t consumer;
+    int retVal = 0;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "ct:r:s:k:d:")))
+    {
+        switch (opt)
+        {
+            case 'c': contention = true; break;
+            case 't': config.Threads = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'r': config.Rate = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 's': config.Size = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'k': sinkBytesPerSec = strtoull(optarg, NULL, 0); break;
+            case 'd': config.Seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [messages] | -c [-t threads] [-r rate] [-s size] [-k sink bytes/s] [-d seconds]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+    {
+        messages = (uint32_t)strtoul(argv[optind], NULL, 0);
+    }
+    config.Threads = MIN(MAX(config.Threads, 1u), (uint32_t)MAX_PRODUCERS);
+    config.Size = MIN(config.Size, (uint32_t)sizeof(payload));
+
+    // the sink counts what fwrite() hands it, don't let stdio hold on to it
+    setvbuf(sink, NULL, _IONBF, 0);
+    LogSinkStdioSetStream(sink);
+
+    if ((eOK != LogInit(NULL)) || (0 != pthread_create(&consumer, NULL, consumerThread, NULL)))
+    {
+        fprintf(stderr, "init failed\n");
+        return 1;
+    }
+    LogSetLevel(eLogTrace);
+
+    if (contention)
+    {
+        retVal = runContention(&config);
+    }
+    else
+    {
+        const uint64_t clockNs = clockOverheadNs();
+
+        printf("%u messages per case, %llu ns of timing overhead subtracted from ns/call\n\n",
+                messages, (unsigned long long)clockNs);
+        printf("%-10s %10s %12s %14s %10s %10s\n", "case", "ns/call", "msgs/s", "bytes/s", "bytes/msg", "eBUSY");
+
+        for (size_t i = 0; i < ARRAY_SIZE(benchCases); i++)
+        {
+            runCase(&benchCases[i], messages, clockNs);
+        }
+    }
+
+    // LogTask() only returns once it has something to write
+    stopConsumer = true;
+    LOG(eLogInfo, "done");
+    pthread_join(consumer, NULL);
+
+    return retVal;
+}
@@ -0,0 +1,1722 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// Host tests, one case per run so that each starts from a fresh process - the
+// logger and the sinks keep their state in statics. ctest runs them all, see
+// CMakeLists.txt. Files are created in the working directory.
+//
+// usage: log_test <case>, with no case the cases are listed
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include <globals.h>
+#include "logger.h"
+#include "logger_port.h"
+#include "log_ring.h"
+#include "log_format.h"
+#include "log_deferred.h"
+#include "log_compress.h"
+#include "log_sink_file.h"
+#include "log_sink_net.h"
+#include "log_sink_ram.h"
+#include "log_sink_stdio.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define CMP_NAME            "Test"
+
+#define CHECK(condition)    check((condition), #condition, __LINE__)
+
+#define TEST_FILE_PATH      "log_test.txt"
+#define TEST_FILE_STREAM    ((LOG_FILE_COUNT + 1) * LOG_FILE_MAX_SIZE + 1234)
+
+// LogRamStore, as laid out in the mapped file: two header copies of six words,
+// the sequence number second and the CRC last, then the data
+#define RAM_HEADER_SIZE     24
+#define RAM_SEQUENCE_OFFSET 4
+#define RAM_CRC_OFFSET      20
+
+#define CAPTURE_SIZE        (64 * 1024)
+
+// Sinks besides the capture, enough to fill the registry along with it
+#define TEST_SINK_COUNT     4
+#define TEST_SINK_SIZE      (16 * 1024)
+#if (LOG_MAX_SINKS > TEST_SINK_COUNT)
+#error "Not enough test sinks to fill the registry"
+#endif
+
+//==============================================================================
+//  Local types
+//==============================================================================
+typedef struct _TestCase
+{
+    const char *            Name;
+    void                    (*Run)(void);
+} TestCase;
+
+// What a test sink got, and how it was called
+typedef struct _TestSinkState
+{
+    char                    Text[TEST_SINK_SIZE];
+    volatile size_t         Length;
+    volatile size_t         WriteSize;      // returned by GetWriteSize(), 0 holds it up
+    volatile bool           ShortWrites;    // takes only half of every write
+    volatile size_t         CloseAt;        // Length at which it takes no more, 0 for never
+    eStatus                 InitResult;
+    unsigned                InitTime;       // us Init() takes
+    volatile unsigned       Inits;
+    volatile unsigned       Writes;
+    volatile unsigned       Flushes;
+    volatile size_t         LargestWrite;
+} TestSinkState;
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static unsigned             failures = 0;
+
+static char                 capture[CAPTURE_SIZE];
+static volatile size_t      captureLength = 0;
+static volatile bool        captureOpen = true;
+static volatile bool        stopConsumer = false;
+static const char *         volatile timeString = "";
+static TestSinkState        testSinkStates[TEST_SINK_COUNT];
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static void check(const bool condition, const char * const text, const int line)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "log_test.cpp:%d: check failed: %s\n", line, text);
+        failures++;
+    }
+}
+
+static uint32_t nowMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(((uint64_t)now.tv_sec * 1000) + (now.tv_nsec / 1000000));
+}
+
+static bool allZero(const uint8_t * const data, const size_t size)
+{
+    bool retVal = true;
+
+    for (size_t i = 0; retVal && (i < size); i++)
+    {
+        retVal = (0 == data[i]);
+    }
+
+    return retVal;
+}
+
+// A byte stream that doesn't repeat at any power of two, so that misplaced
+// blocks show
+static uint8_t streamByte(const size_t index)
+{
+    static const char pattern[] = "0123456789abcdefghijklmnopqrstuvwxyz\n";
+
+    return (uint8_t)pattern[index % (sizeof(pattern) - 1)];
+}
+
+// Appends to capture, also the export target of the RAM sink
+static size_t captureWrite(const uint8_t * const buffer, const size_t size)
+{
+    const size_t count = MIN(size, sizeof(capture) - 1 - captureLength);
+
+    memcpy(&capture[captureLength], buffer, count);
+    captureLength += count;
+    capture[captureLength] = '\0';
+
+    return size;
+}
+
+static eStatus captureInit(void)
+{
+    return eOK;
+}
+
+// No room while closed, the messages wait in the log buffer
+static size_t captureGetWriteSize(void)
+{
+    return captureOpen ? 4096 : 0;
+}
+
+static const LogSink        captureSink = { "Capture", captureInit, captureGetWriteSize, captureWrite, NULL };
+
+static eStatus testSinkInit(TestSinkState * const state)
+{
+    usleep(state->InitTime);
+    __atomic_add_fetch(&state->Inits, 1, __ATOMIC_RELAXED);
+    return state->InitResult;
+}
+
+static size_t testSinkGetWriteSize(const TestSinkState * const state)
+{
+    const size_t closeAt = state->CloseAt;
+
+    return (0 == closeAt) ? state->WriteSize : MIN(state->WriteSize, closeAt - MIN(closeAt, state->Length));
+}
+
+static size_t testSinkWrite(TestSinkState * const state, const uint8_t * const buffer, const size_t size)
+{
+    const size_t written = state->ShortWrites ? (size / 2) : size;
+    const size_t count = MIN(written, sizeof(state->Text) - 1 - state->Length);
+
+    memcpy(&state->Text[state->Length], buffer, count);
+    state->Length += count;
+    state->Text[state->Length] = '\0';
+    state->Writes++;
+    state->LargestWrite = MAX(state->LargestWrite, size);
+
+    return written;
+}
+
+#define TEST_SINK_FUNCTIONS(i) \
+    static eStatus testSinkInit##i(void) { return testSinkInit(&testSinkStates[i]); } \
+    static size_t testSinkGetWriteSize##i(void) { return testSinkGetWriteSize(&testSinkStates[i]); } \
+    static size_t testSinkWrite##i(const uint8_t * const buffer, const size_t size) \
+            { return testSinkWrite(&testSinkStates[i], buffer, size); } \
+    static void testSinkFlush##i(void) { testSinkStates[i].Flushes++; }
+#define TEST_SINK(i)        { "Test" #i, testSinkInit##i, testSinkGetWriteSize##i, testSinkWrite##i, testSinkFlush##i }
+
+TEST_SINK_FUNCTIONS(0)
+TEST_SINK_FUNCTIONS(1)
+TEST_SINK_FUNCTIONS(2)
+TEST_SINK_FUNCTIONS(3)
+
+static const LogSink        testSinks[TEST_SINK_COUNT] = { TEST_SINK(0), TEST_SINK(1), TEST_SINK(2), TEST_SINK(3) };
+
+static void * consumerThread(void * arg)
+{
+    (void)arg;
+
+    while (!stopConsumer)
+    {
+        LogTask();
+    }
+
+    return NULL;
+}
+
+// Gives LogTask() up to a second to write text out
+static bool waitForCapture(const char * const text)
+{
+    for (size_t i = 0; (i < 1000) && (NULL == strstr(capture, text)); i++)
+    {
+        usleep(1000);
+    }
+
+    return (NULL != strstr(capture, text));
+}
+
+// The same for a test sink
+static bool waitForSink(const TestSinkState * const state, const char * const text)
+{
+    for (size_t i = 0; (i < 1000) && (NULL == strstr(state->Text, text)); i++)
+    {
+        usleep(1000);
+    }
+
+    return (NULL != strstr(state->Text, text));
+}
+
+// LogInit() with the capture as the only sink, showing the level and the
+// message only, and LogTask() running in a thread. Returns once it's got a
+// message, by then the slot of the default sink is free again
+static void startLogger(LogInitParams * const params, pthread_t * const consumer)
+{
+    for (size_t i = 0; i < TEST_SINK_COUNT; i++)
+    {
+        testSinkStates[i].InitResult = eOK;
+    }
+
+    CHECK(eOK == LogInit(params));
+    CHECK(eOK == LogRemoveSink(&LogSinkStdio));
+    CHECK(eOK == LogAddSink(&captureSink));
+    CHECK(eOK == LogSetSinkFormat(&captureSink, eLogSinkFormatLevel));
+    LogSetLevel(eLogTrace);
+    CHECK(0 == pthread_create(consumer, NULL, consumerThread, NULL));
+    CHECK(eOK == LOG(eLogInfo, "started"));
+    CHECK(waitForCapture("|started\r\n"));
+}
+
+// The capture has to be open, the last message wakes LogTask() up to stop it
+static void stopLogger(const pthread_t consumer)
+{
+    captureOpen = true;
+    stopConsumer = true;
+    LOG(eLogInfo, "stop");
+    pthread_join(consumer, NULL);
+}
+
+// The captured line holding text, up to its CRLF
+static bool captureLine(const char * const text, char * const line, const size_t size)
+{
+    const char * const found = strstr(capture, text);
+    const char * start = found;
+    const char * end = (NULL != found) ? strstr(found, "\r\n") : NULL;
+
+    while ((NULL != start) && (start > capture) && ('\n' != start[-1]))
+    {
+        start--;
+    }
+    if ((NULL != end) && ((size_t)(end - start) < size))
+    {
+        memcpy(line, start, end - start);
+        line[end - start] = '\0';
+    }
+
+    return (NULL != end) && ((size_t)(end - start) < size);
+}
+
+// Reads the hex dump lines in capture back, checking that each continues where
+// the last one ended and that the bytes are dump's. Returns the bytes read
+static size_t captureDump(const uint8_t * const dump)
+{
+    size_t retVal = 0;
+    bool inOrder = true;
+
+    for (const char * line = capture; inOrder && (NULL != line); line = strstr(line, "\r\n"))
+    {
+        unsigned offset = 0;
+        int used = 0;
+
+        line += ('\r' == line[0]) ? 2 : 0;
+        if ((1 == sscanf(line, "%4X  %n", &offset, &used)) && (6 == used))
+        {
+            inOrder = (offset == retVal);
+            for (const char * hex = &line[used]; inOrder && ('|' != *hex); hex++)
+            {
+                unsigned value;
+                if ((' ' != *hex) && (1 == sscanf(hex, "%2X", &value)))
+                {
+                    inOrder = (dump[retVal++] == value);
+                    hex++;
+                }
+            }
+        }
+    }
+
+    return inOrder ? retVal : 0;
+}
+
+// Runs part of a test in a child process, with statics as they were at the
+// fork - the RAM sink attaches only once per process. Returns its failures
+static unsigned runChild(void (*run)(void))
+{
+    int status = 0;
+    const pid_t pid = fork();
+
+    if (0 == pid)
+    {
+        run();
+        _exit((int)MIN(failures, 100u));
+    }
+
+    return ((pid > 0) && (pid == waitpid(pid, &status, 0)) && WIFEXITED(status)) ? WEXITSTATUS(status) : 1;
+}
+
+//==============================================================================
+//  Ring
+//==============================================================================
+static void testRing(void)
+{
+    static uint8_t storage[256] __attribute__((aligned(LOG_RING_ALIGN)));
+    LogRing ring;
+    size_t size = 0;
+    uint8_t type = 0;
+    uint8_t * record;
+    uint8_t * other;
+
+    CHECK(eINVALIDARG == LogRingInit(&ring, storage, 100));
+    CHECK(eINVALIDARG == LogRingInit(&ring, &storage[1], 128));
+    CHECK(eOK == LogRingInit(&ring, storage, sizeof(storage)));
+
+    // reserved isn't there until it's committed
+    record = LogRingReserve(&ring, 10);
+    CHECK(NULL != record);
+    CHECK(NULL == LogRingPeek(&ring, &size, &type));
+    memcpy(record, "0123456789", 10);
+    LogRingCommit(&ring, record, 1);
+    CHECK(record == LogRingPeek(&ring, &size, &type));
+    CHECK((10 == size) && (1 == type));
+    LogRingConsume(&ring);
+    CHECK(NULL == LogRingPeek(&ring, &size, &type));
+    CHECK(allZero(storage, sizeof(storage)));
+
+    // full at eight records of 32 bytes with their headers
+    CHECK(eOK == LogRingInit(&ring, storage, sizeof(storage)));
+    for (size_t i = 0; i < 8; i++)
+    {
+        record = LogRingReserve(&ring, 28);
+        CHECK(NULL != record);
+        LogRingCommit(&ring, record, 2);
+    }
+    CHECK(NULL == LogRingReserve(&ring, 1));
+    LogRingConsumeTo(&ring, ring.Head);
+    CHECK(allZero(storage, sizeof(storage)));
+
+    // records never wrap, padding fills the end of the buffer
+    CHECK(eOK == LogRingInit(&ring, storage, sizeof(storage)));
+    record = LogRingReserve(&ring, 100);
+    LogRingCommit(&ring, record, 1);
+    record = LogRingReserve(&ring, 100);
+    LogRingCommit(&ring, record, 2);
+    LogRingConsume(&ring);
+    other = LogRingReserve(&ring, 100);
+    CHECK(&storage[LOG_RING_HEADER_SIZE] == other);
+    LogRingCommit(&ring, other, 3);
+    CHECK(record == LogRingPeek(&ring, &size, &type));
+    LogRingConsume(&ring);
+    CHECK((other == LogRingPeek(&ring, &size, &type)) && (3 == type));
+    LogRingConsume(&ring);
+    CHECK(allZero(storage, sizeof(storage)));
+
+    // extend only the last record, trim gives back what it can
+    record = LogRingReserve(&ring, 8);
+    CHECK(LogRingIsLast(&ring, record));
+    CHECK(record == LogRingExtend(&ring, record, 40));
+    LogRingTrim(&ring, record, 8);
+    other = LogRingReserve(&ring, 8);
+    CHECK(&record[8 + LOG_RING_HEADER_SIZE] == other);
+    CHECK(!LogRingIsLast(&ring, record));
+    CHECK(NULL == LogRingExtend(&ring, record, 40));
+    LogRingCommit(&ring, record, 1);
+    LogRingCommit(&ring, other, 2);
+    CHECK((record == LogRingPeek(&ring, &size, &type)) && (8 == size));
+    LogRingConsume(&ring);
+    CHECK((other == LogRingPeek(&ring, &size, &type)) && (2 == type));
+    LogRingConsume(&ring);
+
+    // a discarded record is skipped like padding
+    record = LogRingReserve(&ring, 20);
+    other = LogRingReserve(&ring, 20);
+    memset(record, 0x55, 20);
+    LogRingDiscard(&ring, record);
+    LogRingCommit(&ring, other, 4);
+    CHECK((other == LogRingPeek(&ring, &size, &type)) && (4 == type));
+    LogRingConsume(&ring);
+
+    // a split leaves two records to commit
+    record = LogRingReserve(&ring, 40);
+    other = LogRingSplit(&ring, record, 8);
+    CHECK(&record[8 + LOG_RING_HEADER_SIZE] == other);
+    LogRingCommit(&ring, other, 6);
+    CHECK(NULL == LogRingPeek(&ring, &size, &type));
+    LogRingCommit(&ring, record, 5);
+    CHECK((record == LogRingPeek(&ring, &size, &type)) && (8 == size) && (5 == type));
+    LogRingConsume(&ring);
+    CHECK((other == LogRingPeek(&ring, &size, &type)) && (28 == size) && (6 == type));
+    LogRingConsume(&ring);
+    CHECK(allZero(storage, sizeof(storage)));
+
+    // readers at positions of their own
+    uint32_t first = ring.Tail;
+    uint32_t second = ring.Tail;
+    for (uint8_t i = 1; i <= 3; i++)
+    {
+        record = LogRingReserve(&ring, 4);
+        memcpy(record, &i, 1);
+        LogRingCommit(&ring, record, i);
+    }
+    CHECK((NULL != LogRingPeekAt(&ring, &first, &size, &type)) && (1 == type));
+    first = LogRingNext(&ring, first);
+    CHECK((NULL != LogRingPeekAt(&ring, &first, &size, &type)) && (2 == type));
+    first = LogRingNext(&ring, first);
+    CHECK((NULL != LogRingPeekAt(&ring, &second, &size, &type)) && (1 == type));
+    second = LogRingNext(&ring, second);
+    LogRingConsumeTo(&ring, second);
+    CHECK((NULL != LogRingPeekAt(&ring, &second, &size, &type)) && (2 == type));
+    CHECK((NULL != LogRingPeekAt(&ring, &first, &size, &type)) && (3 == type));
+    first = LogRingNext(&ring, first);
+    CHECK(NULL == LogRingPeekAt(&ring, &first, &size, &type));
+    LogRingConsumeTo(&ring, first);
+    CHECK(ring.Tail == ring.Head);
+    CHECK(allZero(storage, sizeof(storage)));
+
+    // clearing across the end of the buffer
+    memset(storage, 0xff, sizeof(storage));
+    LogRingClear(&ring, sizeof(storage) - 8, sizeof(storage) + 8);
+    CHECK(allZero(&storage[sizeof(storage) - 8], 8) && allZero(storage, 8));
+    CHECK((0xff == storage[8]) && (0xff == storage[sizeof(storage) - 9]));
+}
+
+//==============================================================================
+//  Formatter
+//==============================================================================
+// LogFormatV() against the C library
+static void __attribute__((format(printf, 2, 3))) checkFormat(const int line, const char * const format, ...)
+{
+    char expected[128];
+    char actual[128];
+    LogFormatBuffer buffer;
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(expected, sizeof(expected), format, args);
+    va_end(args);
+
+    va_start(args, format);
+    LogFormatInit(&buffer, actual, sizeof(actual) - 1);
+    LogFormatV(&buffer, format, args);
+    va_end(args);
+    actual[buffer.Length] = '\0';
+
+    if (0 != strcmp(expected, actual))
+    {
+        fprintf(stderr, "log_test.cpp:%d: \"%s\" gave \"%s\", not \"%s\"\n", line, format, actual, expected);
+        failures++;
+    }
+}
+
+// Grants a bit more than asked for, from a larger buffer
+static bool growFormat(LogFormatBuffer * const buffer, const size_t size)
+{
+    char * const larger = (char *)buffer->Context;
+
+    memcpy(larger, buffer->Data, buffer->Length);
+    buffer->Data = larger;
+    buffer->Size = size + 8;
+
+    return true;
+}
+
+static void testFormat(void)
+{
+    checkFormat(__LINE__, "plain text");
+    checkFormat(__LINE__, "%d %i %u", -42, 7, 4000000000u);
+    checkFormat(__LINE__, "[%5d] [%-5d] [%05d] [%+d] [% d]", 42, 42, -42, 42, 42);
+    checkFormat(__LINE__, "%x %X %#x %o %08X", 0xbeefu, 0xbeefu, 255u, 8u, 0x1234u);
+    checkFormat(__LINE__, "%hhd %hd %ld %lld %llu", -1, -2, -3L, -4000000000LL, 18000000000000000000ULL);
+    checkFormat(__LINE__, "%zu %td %jd", (size_t)12, (ptrdiff_t)-12, (intmax_t)12);
+    checkFormat(__LINE__, "%c%c|%3c|%-3c|", 'a', 'b', 'c', 'd');
+    checkFormat(__LINE__, "%s|%.3s|%8s|%-8s|%*s|", "text", "truncated", "right", "left", 4, "ab");
+    checkFormat(__LINE__, "%.2f %.0f %8.3f %-8.1f| %f", 3.14159, 2.0, -1.5, 0.3, 1e6);
+    checkFormat(__LINE__, "%.*d %d%%", 4, 7, 100);
+
+    // writes past the end are dropped
+    char small[5];
+    LogFormatBuffer buffer;
+    LogFormatInit(&buffer, small, sizeof(small));
+    LogFormatString(&buffer, "hello world");
+    CHECK((5 == buffer.Length) && (0 == memcmp(small, "hello", 5)));
+
+    // unless the buffer can grow
+    char larger[64];
+    LogFormatInit(&buffer, small, sizeof(small));
+    buffer.Grow = growFormat;
+    buffer.Context = larger;
+    LogFormatString(&buffer, "hello world");
+    CHECK((11 == buffer.Length) && (0 == memcmp(larger, "hello world", 11)));
+}
+
+//==============================================================================
+//  Deferred formatting
+//==============================================================================
+static bool packTruncated;
+
+static size_t pack(uint8_t * const packed, const size_t size, const char * const format, ...)
+{
+    va_list args;
+
+    packTruncated = false;
+    va_start(args, format);
+    const size_t retVal = LogDeferredPack(packed, size, format, args, &packTruncated);
+    va_end(args);
+
+    return retVal;
+}
+
+static void render(char * const text, const size_t size, const char * const format, const uint8_t * const packed, const size_t packedSize)
+{
+    LogFormatBuffer buffer;
+
+    LogFormatInit(&buffer, text, size - 1);
+    LogDeferredRender(&buffer, format, packed, packedSize);
+    text[buffer.Length] = '\0';
+}
+
+static void testDeferred(void)
+{
+    static const char format[] = "%d %u %x %lld %c %s %.2f %5s|%-4d|%%";
+    uint8_t packed[256];
+    char text[128];
+    char expected[128];
+    char name[] = "sensor";
+
+    size_t size = pack(packed, sizeof(packed), format, -5, 6u, 0xabu, -7LL, 'z', name, 2.5, "ab", 3);
+    snprintf(expected, sizeof(expected), format, -5, 6u, 0xabu, -7LL, 'z', name, 2.5, "ab", 3);
+
+    // strings are copied, the caller may reuse the buffer right away
+    strcpy(name, "reused");
+    render(text, sizeof(text), format, packed, size);
+    CHECK((0 == strcmp(expected, text)) && !packTruncated);
+
+    // width and precision from the arguments, a precision isn't a cut
+    size = pack(packed, sizeof(packed), "[%*d] [%.*s]", 6, 42, 2, "abcdef");
+    render(text, sizeof(text), "[%*d] [%.*s]", packed, size);
+    CHECK((0 == strcmp("[    42] [ab]", text)) && !packTruncated);
+
+    // a string that fits in part is cut
+    size = pack(packed, 8, "%d|%s|", 1, "abcdef");
+    render(text, sizeof(text), "%d|%s|", packed, size);
+    CHECK((0 == strcmp("1|a|", text)) && packTruncated);
+
+    // what doesn't fit is dropped and rendered as empty
+    size = pack(packed, 0, "%d|%s|", 1, "lost");
+    CHECK((0 == size) && packTruncated);
+    render(text, sizeof(text), "%d|%s|", packed, size);
+    CHECK(0 == strcmp("||", text));
+}
+
+//==============================================================================
+//  Compression
+//==============================================================================
+static void checkRoundTrip(const int line, const uint8_t * const data, const size_t size)
+{
+    static uint8_t frame[LOG_COMPRESS_BOUND(8192)];
+    static uint8_t output[8192];
+    const size_t frameSize = LogCompress(data, size, frame, sizeof(frame));
+
+    check((frameSize > 0) && (frameSize <= LOG_COMPRESS_BOUND(size)), "frame within bound", line);
+    check(frameSize == LogCompressFrameSize(frame, frameSize), "frame size", line);
+    check((size == LogDecompress(frame, frameSize, output, sizeof(output))) && (0 == memcmp(data, output, size)),
+            "round trip", line);
+}
+
+static void testCompress(void)
+{
+    static uint8_t text[8192];
+    static uint8_t noise[4096];
+    static uint8_t frame[LOG_COMPRESS_BOUND(sizeof(text))];
+    static uint8_t output[sizeof(text)];
+    size_t used = 0;
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; used < (sizeof(text) - 64); i++)
+    {
+        used += snprintf((char *)&text[used], sizeof(text) - used,
+                "\x1b[32m|%09u|I|Net|poll:rx=%u tx=%u\x1b[34m\r\n", i * 37, i, i * 3);
+    }
+    for (size_t i = 0; i < sizeof(noise); i++)
+    {
+        seed = (seed * 1103515245u) + 12345u;
+        noise[i] = (uint8_t)(seed >> 16);
+    }
+
+    checkRoundTrip(__LINE__, text, used);
+    checkRoundTrip(__LINE__, noise, sizeof(noise));
+    checkRoundTrip(__LINE__, text, 1);
+
+    // log text is what it's for
+    const size_t frameSize = LogCompress(text, used, frame, sizeof(frame));
+    CHECK(frameSize < (used / 2));
+
+    // too small an output, and broken frames
+    CHECK(0 == LogCompress(noise, sizeof(noise), frame, 64));
+    CHECK(0 == LogDecompress(frame, LogCompress(text, used, frame, sizeof(frame)), output, used - 1));
+    frame[0] ^= 0xff;
+    CHECK(0 == LogCompressFrameSize(frame, frameSize));
+    CHECK(0 == LogDecompress(frame, frameSize, output, sizeof(output)));
+
+    // a full block that doesn't compress has more payload than its header
+    // can tell, even with room for it
+    static uint8_t block[LOG_COMPRESS_MAX_BLOCK];
+    static uint8_t blockFrame[LOG_COMPRESS_BOUND(sizeof(block))];
+    for (size_t i = 0; i < sizeof(block); i++)
+    {
+        seed = (seed * 1103515245u) + 12345u;
+        block[i] = (uint8_t)(seed >> 16);
+    }
+    CHECK(0 == LogCompress(block, sizeof(block), blockFrame, sizeof(blockFrame)));
+    const size_t largest = 128 * (LOG_COMPRESS_MAX_PAYLOAD / 129);
+    const size_t largestFrame = LogCompress(block, largest, blockFrame, sizeof(blockFrame));
+    CHECK((largestFrame > largest) && (largestFrame == LogCompressFrameSize(blockFrame, largestFrame)));
+}
+
+//==============================================================================
+//  File sink rotation
+//==============================================================================
+static const char * testFileName(char * const name, const size_t index)
+{
+    if (0 == index)
+    {
+        snprintf(name, LOG_FILE_PATH_SIZE + 11, "%s", TEST_FILE_PATH);
+    }
+    else
+    {
+        snprintf(name, LOG_FILE_PATH_SIZE + 11, "%s.%u", TEST_FILE_PATH, (unsigned)index);
+    }
+
+    return name;
+}
+
+static void testFile(void)
+{
+    static uint8_t chunk[1000];
+    char name[LOG_FILE_PATH_SIZE + 11];
+    size_t written = 0;
+
+    for (size_t i = 0; i <= LOG_FILE_COUNT; i++)
+    {
+        unlink(testFileName(name, i));
+    }
+
+    CHECK(eNOTINITIALIZED == LogSinkFileInit());
+    CHECK(eOK == LogSinkFileSetPath(TEST_FILE_PATH));
+    CHECK(eOK == LogSinkFileInit());
+
+    while (written < TEST_FILE_STREAM)
+    {
+        const size_t count = MIN(sizeof(chunk), TEST_FILE_STREAM - written);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            chunk[i] = streamByte(written + i);
+        }
+        CHECK(count == LogSinkFileWrite(chunk, count));
+        written += count;
+    }
+    LogSinkFileFlush();
+
+    // the oldest file went, the rest hold the end of the stream in order
+    CHECK(0 != access(testFileName(name, LOG_FILE_COUNT), F_OK));
+
+    size_t position = TEST_FILE_STREAM - ((LOG_FILE_COUNT - 1) * LOG_FILE_MAX_SIZE) - (TEST_FILE_STREAM % LOG_FILE_MAX_SIZE);
+    for (size_t i = LOG_FILE_COUNT; i > 0; i--)
+    {
+        FILE * const file = fopen(testFileName(name, i - 1), "rb");
+        size_t size = 0;
+        bool inOrder = (NULL != file);
+        int c;
+
+        while (inOrder && (EOF != (c = fgetc(file))))
+        {
+            inOrder = (streamByte(position + size) == (uint8_t)c);
+            size++;
+        }
+        CHECK(inOrder);
+        CHECK(size == ((i > 1) ? LOG_FILE_MAX_SIZE : (TEST_FILE_STREAM % LOG_FILE_MAX_SIZE)));
+        position += size;
+        if (NULL != file)
+        {
+            fclose(file);
+        }
+    }
+    CHECK(TEST_FILE_STREAM == position);
+
+    for (size_t i = 0; i < LOG_FILE_COUNT; i++)
+    {
+        unlink(testFileName(name, i));
+    }
+}
+
+//==============================================================================
+//  RAM sink reattach
+//==============================================================================
+static void ramWrite(const char * const text)
+{
+    CHECK(strlen(text) == LogSinkRamWrite((const uint8_t *)text, strlen(text)));
+}
+
+static bool ramExported(const char * const expected)
+{
+    captureLength = 0;
+    capture[0] = '\0';
+
+    return (strlen(expected) == LogSinkRamExport(captureWrite)) && (0 == strcmp(expected, capture));
+}
+
+static void ramFirstRun(void)
+{
+    CHECK(eOK == LogSinkRamInit());
+    CHECK(0 == LogSinkRamGetGeneration());
+    CHECK(ramExported(""));
+    ramWrite("first run\n");
+}
+
+static void ramSecondRun(void)
+{
+    CHECK(1 == LogSinkRamGetGeneration());
+    CHECK(ramExported("first run\n"));
+    ramWrite("second run\n");
+}
+
+// After the newer header copy got broken: one write behind
+static void ramThirdRun(void)
+{
+    static uint8_t chunk[64];
+
+    CHECK(2 == LogSinkRamGetGeneration());
+    CHECK(ramExported("first run\n"));
+
+    for (size_t written = 0; written < (LOG_RAM_SIZE + 512); written += sizeof(chunk))
+    {
+        for (size_t i = 0; i < sizeof(chunk); i++)
+        {
+            chunk[i] = streamByte(written + i);
+        }
+        CHECK(sizeof(chunk) == LogSinkRamWrite(chunk, sizeof(chunk)));
+    }
+}
+
+// Only the last LOG_RAM_SIZE bytes are kept
+static void ramFourthRun(void)
+{
+    bool inOrder = true;
+
+    captureLength = 0;
+    CHECK(3 == LogSinkRamGetGeneration());
+    CHECK(LOG_RAM_SIZE == LogSinkRamExport(captureWrite));
+    for (size_t i = 0; inOrder && (i < LOG_RAM_SIZE); i++)
+    {
+        inOrder = (streamByte(512 + i) == (uint8_t)capture[i]);
+    }
+    CHECK(inOrder);
+}
+
+static void ramAfterGarbage(void)
+{
+    CHECK(0 == LogSinkRamGetGeneration());
+    CHECK(ramExported(""));
+}
+
+// Flips the CRC of the newer header copy, or of both
+static void ramBreakHeader(const bool both)
+{
+    FILE * const file = fopen(LOG_RAM_HOST_FILE, "r+b");
+    uint8_t headers[2 * RAM_HEADER_SIZE];
+
+    CHECK((NULL != file) && (sizeof(headers) == fread(headers, 1, sizeof(headers), file)));
+    if (NULL != file)
+    {
+        uint32_t sequence[2];
+        memcpy(&sequence[0], &headers[RAM_SEQUENCE_OFFSET], sizeof(uint32_t));
+        memcpy(&sequence[1], &headers[RAM_HEADER_SIZE + RAM_SEQUENCE_OFFSET], sizeof(uint32_t));
+        const size_t newer = ((int32_t)(sequence[1] - sequence[0]) > 0) ? 1 : 0;
+
+        for (size_t i = 0; i < 2; i++)
+        {
+            headers[(i * RAM_HEADER_SIZE) + RAM_CRC_OFFSET] ^= (both || (i == newer)) ? 0xff : 0;
+        }
+        rewind(file);
+        CHECK(sizeof(headers) == fwrite(headers, 1, sizeof(headers), file));
+        fclose(file);
+    }
+}
+
+static void testRam(void)
+{
+    unlink(LOG_RAM_HOST_FILE);
+
+    failures += runChild(ramFirstRun);
+    failures += runChild(ramSecondRun);
+    ramBreakHeader(false);
+    failures += runChild(ramThirdRun);
+    failures += runChild(ramFourthRun);
+    ramBreakHeader(true);
+    failures += runChild(ramAfterGarbage);
+
+    unlink(LOG_RAM_HOST_FILE);
+}
+
+//==============================================================================
+//  Network sink over loopback
+//==============================================================================
+
+// A UDP socket, or a listening TCP one, on 127.0.0.1 at port - one of the
+// system's choosing if 0, set to the one it got. Returns the socket, -1 if
+// that failed
+static int openListener(const int type, uint16_t * const port)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    const int one = 1;
+    int retVal = socket(AF_INET, type, 0);
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(*port);
+    if ((retVal >= 0) &&
+        ((0 != setsockopt(retVal, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))) ||
+         (0 != bind(retVal, (const struct sockaddr *)&address, sizeof(address))) ||
+         ((SOCK_STREAM == type) && (0 != listen(retVal, 1))) ||
+         (0 != getsockname(retVal, (struct sockaddr *)&address, &length))))
+    {
+        close(retVal);
+        retVal = -1;
+    }
+    *port = ntohs(address.sin_port);
+
+    return retVal;
+}
+
+static bool readable(const int fd, const int timeout)
+{
+    struct pollfd poller = { fd, POLLIN, 0 };
+
+    return (1 == poll(&poller, 1, timeout));
+}
+
+// Appends the datagrams that arrive to received, checking that each is a
+// whole number of lines and no larger than a datagram may be
+static void receiveDatagrams(const int fd, uint8_t * const received, size_t * const receivedSize, const size_t size)
+{
+    uint8_t datagram[LOG_NET_DATAGRAM_SIZE + 1];
+
+    while (readable(fd, 100))
+    {
+        const ssize_t count = recv(fd, datagram, sizeof(datagram), 0);
+
+        CHECK((count > 0) && (count <= LOG_NET_DATAGRAM_SIZE) && ('\n' == datagram[count - 1]));
+        if ((count > 0) && ((*receivedSize + count) <= size))
+        {
+            memcpy(&received[*receivedSize], datagram, count);
+            *receivedSize += count;
+        }
+    }
+}
+
+// Lines of all sorts of lengths straight to the sink. Full datagrams go out
+// as the queue fills, the last partial one only when flushed
+static void netUdp(void)
+{
+    static uint8_t sent[LOG_NET_QUEUE_SIZE];
+    static uint8_t received[LOG_NET_QUEUE_SIZE];
+    uint16_t port = 0;
+    const int listener = openListener(SOCK_DGRAM, &port);
+    size_t sentSize = 0;
+    size_t receivedSize = 0;
+
+    CHECK(listener >= 0);
+    CHECK(eNOTINITIALIZED == LogSinkNetInit());
+    CHECK(eINVALIDARG == LogSinkNetSetTarget(eLogNetUdp, "localhost", port));
+    CHECK(eOK == LogSinkNetSetTarget(eLogNetUdp, "127.0.0.1", port));
+    CHECK(eOK == LogSinkNetInit());
+
+    for (size_t i = 0; (sentSize + 140) < sizeof(sent); i++)
+    {
+        const size_t length = 20 + ((i * 37) % 120);
+
+        for (size_t j = 0; j < length; j++)
+        {
+            sent[sentSize + j] = (j < (length - 1)) ? streamByte(i + j) : '\n';
+        }
+        CHECK(length == LogSinkNetWrite(&sent[sentSize], length));
+        sentSize += length;
+    }
+
+    receiveDatagrams(listener, received, &receivedSize, sizeof(received));
+    CHECK((receivedSize > 0) && (receivedSize < sentSize) && ((sentSize - receivedSize) < LOG_NET_DATAGRAM_SIZE));
+    CHECK(LOG_NET_QUEUE_SIZE == (LogSinkNetGetWriteSize() + (sentSize - receivedSize)));
+
+    LogSinkNetFlush();
+    receiveDatagrams(listener, received, &receivedSize, sizeof(received));
+    CHECK((sentSize == receivedSize) && (0 == memcmp(sent, received, sentSize)));
+    CHECK(LOG_NET_QUEUE_SIZE == LogSinkNetGetWriteSize());
+
+    // exactly a datagram queued, the last line in it not whole yet
+    memset(sent, 'a', LOG_NET_DATAGRAM_SIZE + 1);
+    sent[99] = '\n';
+    sent[LOG_NET_DATAGRAM_SIZE] = '\n';
+    CHECK(LOG_NET_DATAGRAM_SIZE == LogSinkNetWrite(sent, LOG_NET_DATAGRAM_SIZE));
+    CHECK(1 == LogSinkNetWrite(&sent[LOG_NET_DATAGRAM_SIZE], 1));
+    LogSinkNetFlush();
+    receivedSize = 0;
+    receiveDatagrams(listener, received, &receivedSize, sizeof(received));
+    CHECK((LOG_NET_DATAGRAM_SIZE + 1) == receivedSize);
+
+    close(listener);
+}
+
+// Through LogTask(): nobody listens at first, which must not hold it up, then
+// the sink connects once its backoff runs out and sends what it kept meanwhile
+static void netTcp(void)
+{
+    static char received[LOG_NET_QUEUE_SIZE];
+    size_t receivedSize = 0;
+    uint16_t port = 0;
+    int listener = openListener(SOCK_STREAM, &port);
+    int peer = -1;
+    uint32_t slowest = 0;
+
+    close(listener);
+    CHECK(eOK == LogSinkNetSetTarget(eLogNetTcp, "127.0.0.1", port));
+    CHECK(eOK == LogInit(NULL));
+    CHECK(eOK == LogRemoveSink(&LogSinkStdio));
+    CHECK(eOK == LogAddSink(&LogSinkNet));
+    CHECK(eOK == LogSetSinkFormat(&LogSinkNet, eLogSinkFormatLevel));
+
+    const uint32_t downSince = nowMs();
+    for (unsigned i = 0; i < 20; i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, "down %u", i));
+        const uint32_t start = nowMs();
+        LogTask();
+        slowest = MAX(slowest, nowMs() - start);
+    }
+    CHECK(slowest < 50);
+
+    listener = openListener(SOCK_STREAM, &port);
+    CHECK(listener >= 0);
+    for (unsigned i = 0; (listener >= 0) && (peer < 0) && ((nowMs() - downSince) < (4 * LOG_NET_BACKOFF_MIN)); i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, "up %u", i));
+        LogTask();
+        peer = readable(listener, 10) ? accept(listener, NULL, NULL) : -1;
+    }
+    CHECK(peer >= 0);
+    CHECK((nowMs() - downSince) >= LOG_NET_BACKOFF_MIN);
+
+    for (unsigned i = 0; (peer >= 0) && (i < 100) && (NULL == strstr(received, "I|last\r\n")); i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, (0 == i) ? "last" : "after"));
+        LogTask();
+        while (readable(peer, 10) && (receivedSize < (sizeof(received) - 1)))
+        {
+            const ssize_t count = recv(peer, &received[receivedSize], sizeof(received) - 1 - receivedSize, 0);
+            receivedSize += (count > 0) ? count : 0;
+            received[receivedSize] = '\0';
+        }
+    }
+
+    // nothing lost while it was down, in order
+    CHECK(received == strstr(received, "I|down 0\r\nI|down 1\r\n"));
+    CHECK(NULL != strstr(received, "I|down 19\r\nI|up 0\r\n"));
+    CHECK(NULL != strstr(received, "I|last\r\n"));
+
+    close(peer);
+    close(listener);
+}
+
+static void testNet(void)
+{
+    failures += runChild(netUdp);
+    failures += runChild(netTcp);
+}
+
+//==============================================================================
+//  Sink registration
+//==============================================================================
+#define RACE_THREADS        4
+#define RACE_ROUNDS         50
+
+static pthread_barrier_t    raceBarrier;
+static volatile unsigned    raceAdded = 0;
+
+// Logs text and waits for it to reach the capture. Once it has, a round that
+// started after the call wrote it out - sinks added or removed before are
+// picked up
+static bool logMarker(const char * const text)
+{
+    char line[64];
+
+    snprintf(line, sizeof(line), "|%s\r\n", text);
+
+    return (eOK == LOG(eLogInfo, "%s", text)) && waitForCapture(line);
+}
+
+static void * raceThread(void * arg)
+{
+    (void)arg;
+
+    for (size_t i = 0; i < RACE_ROUNDS; i++)
+    {
+        pthread_barrier_wait(&raceBarrier);
+        if (eOK == LogAddSink(&testSinks[TEST_SINK_COUNT - 1]))
+        {
+            __atomic_add_fetch(&raceAdded, 1, __ATOMIC_RELAXED);
+        }
+        pthread_barrier_wait(&raceBarrier);
+    }
+
+    return NULL;
+}
+
+static void testRegistry(void)
+{
+    TestSinkState * const first = &testSinkStates[0];
+    TestSinkState * const last = &testSinkStates[TEST_SINK_COUNT - 1];
+    pthread_t consumer;
+    pthread_t racers[RACE_THREADS];
+    char marker[32];
+
+    startLogger(NULL, &consumer);
+
+    // a sink is only there once, a full registry leaves it alone
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    CHECK(eINVALIDARG == LogAddSink(&testSinks[0]));
+    CHECK(1 == first->Inits);
+    for (size_t i = 1; i < (LOG_MAX_SINKS - 1); i++)
+    {
+        CHECK(eOK == LogAddSink(&testSinks[i]));
+    }
+    CHECK(eFAILED == LogAddSink(&testSinks[TEST_SINK_COUNT - 1]));
+    CHECK(0 == last->Inits);
+
+    // one added while LogTask() runs gets what's logged after
+    first->WriteSize = 4096;
+    CHECK(logMarker("while 0"));
+    CHECK(logMarker("while 1"));
+    CHECK((NULL != strstr(first->Text, "while 0")) && (NULL != strstr(first->Text, "while 1")));
+
+    // removed ones are flushed and get nothing more, their slots are free again
+    for (size_t i = 0; i < (LOG_MAX_SINKS - 1); i++)
+    {
+        CHECK(eOK == LogRemoveSink(&testSinks[i]));
+    }
+    CHECK(eINVALIDARG == LogRemoveSink(&testSinks[0]));
+    CHECK(logMarker("removed"));
+    CHECK(logMarker("after removal"));
+    CHECK((NULL == strstr(first->Text, "after removal")) && (first->Flushes > 0));
+
+    // a failed Init() gives the slot back
+    last->InitResult = eFAILED;
+    CHECK(eFAILED == LogAddSink(&testSinks[TEST_SINK_COUNT - 1]));
+    last->InitResult = eOK;
+    for (size_t i = 0; i < (LOG_MAX_SINKS - 1); i++)
+    {
+        CHECK(eOK == LogAddSink(&testSinks[TEST_SINK_COUNT - 1 - i]));
+    }
+    for (size_t i = 0; i < (LOG_MAX_SINKS - 1); i++)
+    {
+        CHECK(eOK == LogRemoveSink(&testSinks[TEST_SINK_COUNT - 1 - i]));
+    }
+    CHECK(logMarker("removed again"));
+
+    // several tasks adding the same sink at once: it is added and initialized
+    // once at most, however long Init() takes
+    last->Inits = 0;
+    last->InitTime = 1000;
+    CHECK(0 == pthread_barrier_init(&raceBarrier, NULL, RACE_THREADS + 1));
+    for (size_t i = 0; i < RACE_THREADS; i++)
+    {
+        CHECK(0 == pthread_create(&racers[i], NULL, raceThread, NULL));
+    }
+    for (size_t i = 0; i < RACE_ROUNDS; i++)
+    {
+        raceAdded = 0;
+        pthread_barrier_wait(&raceBarrier);
+        pthread_barrier_wait(&raceBarrier);
+        CHECK((raceAdded <= 1) && (raceAdded == last->Inits));
+        last->Inits = 0;
+        CHECK((eOK == LogRemoveSink(&testSinks[TEST_SINK_COUNT - 1])) == (1 == raceAdded));
+        snprintf(marker, sizeof(marker), "race %u", (unsigned)i);
+        CHECK(logMarker(marker));
+    }
+    for (size_t i = 0; i < RACE_THREADS; i++)
+    {
+        pthread_join(racers[i], NULL);
+    }
+    pthread_barrier_destroy(&raceBarrier);
+
+    stopLogger(consumer);
+}
+
+//==============================================================================
+//  Overflow
+//==============================================================================
+#define OVERFLOW_TIMEOUT    300     // ms, eLogOverflowBlock
+#define OVERFLOW_CUT_AT     20      // bytes of a message a sink gets before it is evicted
+
+static volatile uint32_t    unblockAt = 0;
+
+// Logs until the buffer is full. Returns the number of messages that made it
+static unsigned fillBuffer(void)
+{
+    unsigned retVal = 0;
+
+    while ((retVal < 10000) && (eOK == LOG(eLogInfo, "fill %u", retVal)))
+    {
+        retVal++;
+    }
+
+    return retVal;
+}
+
+// The stats of the sink called name, NULL if there's none
+static const LogSinkStats * sinkStats(const LogStats * const stats, const char * const name)
+{
+    const LogSinkStats * retVal = NULL;
+
+    for (size_t i = 0; (NULL == retVal) && (i < stats->SinkCount); i++)
+    {
+        if (0 == strcmp(stats->Sinks[i].Name, name))
+        {
+            retVal = &stats->Sinks[i];
+        }
+    }
+
+    return retVal;
+}
+
+static void * unblockThread(void * arg)
+{
+    (void)arg;
+
+    usleep(50000);
+    unblockAt = nowMs();
+    captureOpen = true;
+
+    return NULL;
+}
+
+static void overflowDropNewest(void)
+{
+    pthread_t consumer;
+    LogStats stats;
+    char text[32];
+
+    startLogger(NULL, &consumer);
+
+    // dropped right away, counted, and reported once there's room again
+    captureOpen = false;
+    const unsigned filled = fillBuffer();
+    const uint32_t start = nowMs();
+    CHECK((filled > 0) && (filled < 10000));
+    CHECK(eBUSY == LOG(eLogInfo, "dropped too"));
+    CHECK((nowMs() - start) < 20);
+    CHECK((eOK == LogGetStats(&stats)) && (2 == stats.MessagesDropped) && (0 == stats.BlockTimeouts));
+
+    captureOpen = true;
+    snprintf(text, sizeof(text), "|fill %u\r\n", filled - 1);
+    CHECK(waitForCapture(text) && (NULL != strstr(capture, "|fill 0\r\n")));
+    CHECK(logMarker("after drop"));
+    CHECK((NULL != strstr(capture, "2 messages dropped")) && (NULL == strstr(capture, "dropped too")));
+
+    stopLogger(consumer);
+}
+
+static void overflowBlock(void)
+{
+    LogInitParams params = { eLogOverflowBlock, OVERFLOW_TIMEOUT };
+    TestSinkState * const first = &testSinkStates[0];
+    pthread_t consumer;
+    pthread_t unblocker;
+    LogStats stats;
+    uint32_t start;
+
+    startLogger(&params, &consumer);
+
+    // waits for the timeout, then drops it
+    captureOpen = false;
+    CHECK(fillBuffer() > 0);
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.BlockTimeouts) && (stats.BlockWaitTime >= OVERFLOW_TIMEOUT));
+    CHECK(1 == stats.MessagesDropped);
+
+    // or gets in once LogTask() makes room meanwhile
+    CHECK(0 == pthread_create(&unblocker, NULL, unblockThread, NULL));
+    start = nowMs();
+    CHECK(eOK == LOG(eLogInfo, "unblocked"));
+    CHECK(((nowMs() - start) < OVERFLOW_TIMEOUT) && ((int32_t)(nowMs() - unblockAt) >= 0));
+    pthread_join(unblocker, NULL);
+    CHECK(waitForCapture("|unblocked\r\n"));
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.BlockTimeouts));
+
+    // LogTask() never waits on itself: the warnings of a sink taking short
+    // writes while the buffer is full are dropped rather than waited for
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    captureOpen = false;
+    CHECK(fillBuffer() > 0);
+    first->ShortWrites = true;
+    first->WriteSize = 4096;
+    start = nowMs();
+    for (size_t i = 0; (i < 2000) && (eOK == LogGetStats(&stats)) && (sinkStats(&stats, "Test0")->WriteErrors < 3); i++)
+    {
+        usleep(1000);
+    }
+    CHECK((sinkStats(&stats, "Test0")->WriteErrors >= 3) && ((nowMs() - start) < OVERFLOW_TIMEOUT));
+    CHECK(2 == stats.BlockTimeouts);
+
+    first->ShortWrites = false;
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+    stopLogger(consumer);
+}
+
+static void overflowOverwriteOldest(void)
+{
+    LogInitParams params = { eLogOverflowOverwriteOldest, 0 };
+    TestSinkState * const first = &testSinkStates[0];
+    pthread_t consumer;
+    LogStats stats;
+    char longText[61];
+
+    startLogger(&params, &consumer);
+
+    // a sink that got part of the oldest message only, when it is evicted
+    captureOpen = false;
+    first->CloseAt = OVERFLOW_CUT_AT;
+    first->WriteSize = 4096;
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    CHECK(eOK == LogSetSinkFormat(&testSinks[0], eLogSinkFormatLevel));
+    memset(longText, 'x', sizeof(longText) - 1);
+    longText[sizeof(longText) - 1] = '\0';
+    CHECK(eOK == LOG(eLogInfo, "cut %s", longText));
+    for (size_t i = 0; (i < 1000) && (first->Length < OVERFLOW_CUT_AT); i++)
+    {
+        usleep(1000);
+    }
+    CHECK(OVERFLOW_CUT_AT == first->Length);
+
+    // nothing new is dropped, the oldest ones make room
+    for (unsigned i = 0; i < 300; i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, "flood %u", i));
+    }
+    CHECK((eOK == LogGetStats(&stats)) && (stats.MessagesEvicted > 0) && (stats.MessagesEvicted == stats.MessagesDropped));
+    CHECK(sinkStats(&stats, "Test0")->MessagesDropped > 0);
+
+    first->CloseAt = 0;
+    captureOpen = true;
+    CHECK(logMarker("after flood"));
+    CHECK((NULL != strstr(capture, "|flood 299\r\n")) && (NULL == strstr(capture, "|flood 0\r\n")));
+    CHECK(NULL != strstr(capture, "messages dropped"));
+    CHECK(waitForSink(first, "after flood"));
+
+    // its line ended short, the next message starts a line of its own, and
+    // the loss is reported once it caught up
+    const char * const end = strstr(first->Text, "\r\n");
+    CHECK((&first->Text[OVERFLOW_CUT_AT] == end) && (0 == strncmp(&end[2], "I|flood ", 8)));
+    CHECK((NULL == strstr(first->Text, longText)) && (NULL != strstr(first->Text, "flood 299")));
+    CHECK(strstr(first->Text, "messages dropped") > strstr(first->Text, "after flood"));
+
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+    stopLogger(consumer);
+}
+
+static void testOverflow(void)
+{
+    failures += runChild(overflowDropNewest);
+    failures += runChild(overflowBlock);
+    failures += runChild(overflowOverwriteOldest);
+}
+
+//==============================================================================
+//  Lag
+//==============================================================================
+static void testLag(void)
+{
+    TestSinkState * const first = &testSinkStates[0];
+    pthread_t consumer;
+    LogStats stats;
+    char text[32];
+    unsigned reported = 0;
+    bool accepted = true;
+
+    startLogger(NULL, &consumer);
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    CHECK(eOK == LogSetSinkFormat(&testSinks[0], eLogSinkFormatLevel));
+
+    // a stalled sink doesn't hold up the capture or the producers, it skips
+    // its oldest messages once too far behind
+    first->WriteSize = 0;
+    for (unsigned i = 0; i < 200; i++)
+    {
+        snprintf(text, sizeof(text), "|lag %u\r\n", i);
+        accepted = accepted && (eOK == LOG(eLogInfo, "lag %u", i)) && waitForCapture(text);
+    }
+    CHECK(accepted);
+    CHECK((eOK == LogGetStats(&stats)) && (0 == stats.MessagesDropped));
+    CHECK(0 == sinkStats(&stats, "Capture")->MessagesDropped);
+    CHECK(sinkStats(&stats, "Test0")->MessagesDropped > 0);
+    CHECK(sinkStats(&stats, "Test0")->Lag <= ((stats.BufferSize / 2) + 64));
+
+    // once it takes more, it gets the newest ones and how many it missed
+    first->WriteSize = 4096;
+    CHECK(logMarker("caught up") && waitForSink(first, "I|caught up\r\n"));
+    CHECK((NULL == strstr(first->Text, "I|lag 0\r\n")) && (NULL != strstr(first->Text, "I|lag 199\r\n")));
+    const char * const marker = strstr(first->Text, "W|");
+    CHECK((NULL != marker) && (1 == sscanf(marker, "W|%u messages dropped", &reported)));
+    CHECK((eOK == LogGetStats(&stats)) && (reported == sinkStats(&stats, "Test0")->MessagesDropped));
+    CHECK(0 == sinkStats(&stats, "Capture")->MessagesDropped);
+
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+    stopLogger(consumer);
+}
+
+//==============================================================================
+//  Per-sink level and format
+//==============================================================================
+static void testLevels(void)
+{
+    TestSinkState * const first = &testSinkStates[0];
+    TestSinkState * const second = &testSinkStates[1];
+    pthread_t consumer;
+    char line[256];
+    unsigned time = 0;
+    int length = 0;
+
+    startLogger(NULL, &consumer);
+    first->WriteSize = 4096;
+    second->WriteSize = 4096;
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    CHECK(eOK == LogAddSink(&testSinks[1]));
+
+    // not for sinks that aren't added, nor for levels or flags that don't exist
+    CHECK(eINVALIDARG == LogSetSinkLevel(&testSinks[2], eLogWarn));
+    CHECK(eINVALIDARG == LogSetSinkLevel(&testSinks[0], eLogLevelCount));
+    CHECK(eINVALIDARG == LogSetSinkFormat(&testSinks[2], eLogSinkFormatLevel));
+    CHECK(eINVALIDARG == LogSetSinkFormat(&testSinks[0], 0x80));
+
+    // a sink's level holds back only what that sink gets
+    CHECK(eOK == LogSetSinkLevel(&testSinks[0], eLogWarn));
+    CHECK(eOK == LogSetSinkFormat(&testSinks[0], eLogSinkFormatLevel));
+    CHECK(eOK == LogSetSinkFormat(&testSinks[1], eLogSinkFormatComponent | eLogSinkFormatFunction));
+    CHECK(eOK == LOG(eLogInfo, "below"));
+    CHECK(eOK == LOG(eLogWarn, "at"));
+    CHECK(eOK == LOG(eLogError, "above"));
+    CHECK(waitForCapture("E|above\r\n") && waitForSink(first, "E|above\r\n"));
+    CHECK(waitForSink(second, "Test|testLevels:above\r\n"));
+    CHECK((NULL != strstr(capture, "I|below\r\n")) && (NULL != strstr(capture, "W|at\r\n")));
+    CHECK((NULL == strstr(first->Text, "below")) && (NULL != strstr(first->Text, "W|at\r\n")));
+    CHECK((NULL != strstr(second->Text, "Test|testLevels:below\r\n")) && (NULL != strstr(second->Text, "Test|testLevels:at\r\n")));
+
+    // lowered again, it gets everything from the next message on
+    CHECK(eOK == LogSetSinkLevel(&testSinks[0], eLogTrace));
+    CHECK(eOK == LOG(eLogDebug, "lowered"));
+    CHECK(waitForSink(first, "D|lowered\r\n"));
+
+    // the color of the level, reset before the line ends
+    CHECK(eOK == LogSetSinkFormat(&testSinks[1], eLogSinkFormatColor | eLogSinkFormatLevel));
+    CHECK(eOK == LOG(eLogWarn, "colored"));
+    CHECK(waitForSink(second, "colored"));
+    CHECK(NULL != strstr(second->Text, "\033[33mW|colored\033[34m\r\n"));
+
+    // the time, zero-padded, with nothing else than the message
+    CHECK(eOK == LogSetSinkFormat(&testSinks[1], eLogSinkFormatTime));
+    CHECK(eOK == LOG(eLogInfo, "timed"));
+    CHECK(waitForSink(second, "|timed\r\n"));
+    const char * const timed = strstr(second->Text, "|timed\r\n");
+    CHECK((timed - second->Text) > LOG_PORT_TIME_DIGITS);
+    CHECK((1 == sscanf(timed - LOG_PORT_TIME_DIGITS, "%u%n", &time, &length)) && (LOG_PORT_TIME_DIGITS == length));
+    CHECK('\n' == timed[-LOG_PORT_TIME_DIGITS - 1]);
+
+    // all of it, in order; the capture kept its own format throughout
+    CHECK(eOK == LogSetSinkFormat(&testSinks[1], eLogSinkFormatAll & ~eLogSinkFormatColor));
+    timeString = "T-all";
+    CHECK(eOK == LOG(eLogInfo, "everything"));
+    CHECK(waitForSink(second, "everything"));
+    timeString = "";
+    const char * const all = strstr(second->Text, "T-all|");
+    CHECK((NULL != all) && (2 == sscanf(all, "T-all|%u|I|Test|testLevels:%255[^\r]", &time, line)));
+    CHECK(0 == strcmp(line, "everything"));
+    CHECK(captureLine("everything", line, sizeof(line)) && (0 == strcmp(line, "I|everything")));
+
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+    CHECK(eOK == LogRemoveSink(&testSinks[1]));
+    stopLogger(consumer);
+}
+
+//==============================================================================
+//  ISR
+//==============================================================================
+static void testIsr(void)
+{
+    pthread_t consumer;
+    LogStats stats;
+    char text[32];
+    unsigned filled = 0;
+
+    startLogger(NULL, &consumer);
+
+    // integer arguments, rendered by LogTask()
+    CHECK(eOK == LOG_ISR(eLogInfo, "isr none"));
+    CHECK(eOK == LOG_ISR(eLogInfo, "isr %d", -5));
+    CHECK(eOK == LOG_ISR(eLogWarn, "isr %u %x", 0xffffffffu, 0xbeefu));
+    CHECK(eOK == LOG_ISR(eLogError, "isr %d %u %X %c", INT32_MIN, 7u, 0xabcu, 'z'));
+    CHECK(logMarker("after isr"));
+    CHECK(NULL != strstr(capture, "I|isr none\r\n"));
+    CHECK(NULL != strstr(capture, "I|isr -5\r\n"));
+    CHECK(NULL != strstr(capture, "W|isr 4294967295 beef\r\n"));
+    CHECK(NULL != strstr(capture, "E|isr -2147483648 7 ABC z\r\n"));
+
+    // merged with the task ring in the order they were logged, as far as the
+    // timestamps tell apart
+    CHECK(eOK == LOG(eLogInfo, "order 1"));
+    usleep(100);
+    CHECK(eOK == LOG_ISR(eLogInfo, "order %d", 2));
+    usleep(100);
+    CHECK(eOK == LOG(eLogInfo, "order 3"));
+    CHECK(waitForCapture("|order 3\r\n"));
+    CHECK((strstr(capture, "|order 1\r\n") < strstr(capture, "|order 2\r\n")) &&
+          (strstr(capture, "|order 2\r\n") < strstr(capture, "|order 3\r\n")));
+
+    // a full ISR ring drops the new record, tasks still get in
+    captureOpen = false;
+    while ((filled < 10000) && (eOK == LOG_ISR(eLogInfo, "isr fill %u", filled)))
+    {
+        filled++;
+    }
+    CHECK((filled > 0) && (filled < 10000));
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.MessagesDropped));
+    CHECK(eOK == LOG(eLogInfo, "task while full"));
+    captureOpen = true;
+    snprintf(text, sizeof(text), "|isr fill %u\r\n", filled - 1);
+    CHECK(waitForCapture(text) && waitForCapture("|task while full\r\n"));
+    CHECK(waitForCapture("1 message dropped"));
+
+    // filtered like LOG()
+    LogSetLevel(eLogWarn);
+    CHECK(eOK == LOG_ISR(eLogInfo, "isr filtered"));
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.MessagesFiltered));
+    LogSetLevel(eLogTrace);
+    CHECK(logMarker("after filtered"));
+    CHECK(NULL == strstr(capture, "isr filtered"));
+
+    stopLogger(consumer);
+}
+
+//==============================================================================
+//  Batch
+//==============================================================================
+#if defined(LOG_BATCH_SIZE) && (LOG_BATCH_SIZE > 0)
+static void testBatch(void)
+{
+    TestSinkState * const first = &testSinkStates[0];
+    pthread_t consumer;
+    unsigned writes;
+    uint32_t start;
+    char text[LOG_BATCH_SIZE / 8];
+
+    startLogger(NULL, &consumer);
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    CHECK(eOK == LogSetSinkFormat(&testSinks[0], eLogSinkFormatLevel));
+    first->WriteSize = 4096;
+    CHECK(logMarker("ready") && waitForSink(first, "ready"));
+
+    // a single message waits for more to join it, up to the latency
+    writes = first->Writes;
+    start = nowMs();
+    CHECK(eOK == LOG(eLogInfo, "lone"));
+    CHECK(waitForSink(first, "I|lone\r\n"));
+    CHECK(((nowMs() - start) >= LOG_BATCH_MAX_LATENCY) && ((writes + 1) == first->Writes));
+
+    // a burst goes out in one write
+    writes = first->Writes;
+    for (unsigned i = 0; i < 20; i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, "burst %u", i));
+    }
+    CHECK(waitForSink(first, "I|burst 19\r\n"));
+    CHECK((NULL != strstr(first->Text, "I|burst 0\r\n")) && ((first->Writes - writes) <= 2));
+
+    // a full batch doesn't wait, and no write is larger than one
+    memset(text, 'b', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    start = nowMs();
+    for (unsigned i = 0; i < 16; i++)
+    {
+        CHECK(eOK == LOG(eLogInfo, "full %u %s", i, text));
+    }
+    CHECK(waitForSink(first, "I|full 0 "));
+    CHECK((nowMs() - start) < LOG_BATCH_MAX_LATENCY);
+    CHECK(waitForSink(first, "I|full 15 ") && (first->LargestWrite <= LOG_BATCH_SIZE));
+
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+    stopLogger(consumer);
+}
+#endif // LOG_BATCH_SIZE
+
+//==============================================================================
+//  Logger
+//==============================================================================
+static void testLogger(void)
+{
+    static uint8_t dump[1024];
+    static char longText[1000];
+    pthread_t consumer;
+    LogStats stats;
+    uint8_t * bigDump;
+    char line[1024];
+
+    startLogger(NULL, &consumer);
+    CHECK(eOK == LogSetSinkFormat(&captureSink, eLogSinkFormatTimeString | eLogSinkFormatLevel));
+
+    // the time string is the one at the LOG() call, not when it's written out
+    captureOpen = false;
+    timeString = "T-one";
+    CHECK(eOK == LOG(eLogInfo, "first"));
+    timeString = "T-two";
+    CHECK(eOK == LOG(eLogInfo, "second"));
+    captureOpen = true;
+    CHECK(waitForCapture("second"));
+    CHECK(captureLine("first", line, sizeof(line)) && (NULL != strstr(line, "T-one")));
+    CHECK(captureLine("second", line, sizeof(line)) && (NULL != strstr(line, "T-two")));
+    CHECK(eOK == LogSetSinkFormat(&captureSink, eLogSinkFormatLevel));
+
+#if defined(LOG_DEFERRED_FORMAT) && (LOG_DEFERRED_FORMAT == 1)
+    // rendered by LogTask() from what the arguments were at the LOG() call,
+    // strings included
+    char name[] = "sensor";
+    captureOpen = false;
+    CHECK(eOK == LOG(eLogInfo, "deferred %s %d %u %x %lld %c %.2f [%5s|%-4d] %%",
+            name, -5, 6u, 0xabu, -7LL, 'z', 2.5, "ab", 3));
+    strcpy(name, "reused");
+    captureOpen = true;
+    CHECK(waitForCapture("] %\r\n"));
+    CHECK(captureLine("deferred ", line, sizeof(line)));
+    CHECK(0 == strcmp(line, "I|deferred sensor -5 6 ab -7 z 2.50 [   ab|3   ] %"));
+#endif // LOG_DEFERRED_FORMAT
+
+    // filtered by the macros, counted all the same
+    LogSetLevel(eLogWarn);
+    CHECK(eOK == LOG(eLogInfo, "filtered"));
+    CHECK(eOK == LOG_DUMP_BUFFER(eLogDebug, dump, sizeof(dump)));
+    CHECK((eOK == LogGetStats(&stats)) && (2 == stats.MessagesFiltered));
+    LogSetLevel(eLogTrace);
+
+    // cut at the record size, but still a whole line, and counted
+    memset(longText, 'x', sizeof(longText) - 1);
+    CHECK(eOK == LOG(eLogInfo, "long %s end", longText));
+    CHECK(eOK == LOG(eLogInfo, "after long"));
+    CHECK(waitForCapture("after long"));
+    CHECK(captureLine("long x", line, sizeof(line)) && (NULL == strstr(line, longText)));
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.MessagesTruncated));
+
+    // a dump larger than a record arrives whole
+    for (size_t i = 0; i < sizeof(dump); i++)
+    {
+        dump[i] = (uint8_t)i;
+    }
+    CHECK(eOK == LOG_DUMP_BUFFER(eLogInfo, dump, sizeof(dump)));
+    CHECK(eOK == LOG(eLogInfo, "after dump"));
+    CHECK(waitForCapture("after dump"));
+    CHECK(sizeof(dump) == captureDump(dump));
+
+    // on a sink with color, the header line ends with a reset like any
+    // message, the hex lines have none
+    CHECK(eOK == LogAddSink(&testSinks[0]));
+    testSinkStates[0].WriteSize = 4096;
+    CHECK(eOK == LOG_DUMP_BUFFER(eLogInfo, dump, 20));
+    CHECK(logMarker("after color dump") && waitForSink(&testSinkStates[0], "after color dump"));
+    const char * const dumpHeader = strstr(testSinkStates[0].Text, ":20 bytes\033[");
+    const char * const dumpLine = (NULL != dumpHeader) ? strstr(dumpHeader, "m\r\n0000  ") : NULL;
+    CHECK((NULL != dumpLine) && (NULL == memchr(dumpLine, '\033', strstr(&dumpLine[3], "\r\n0010  ") - dumpLine)));
+    CHECK(eOK == LogRemoveSink(&testSinks[0]));
+
+    // one larger than a ring arrives whole too, in parts
+    CHECK(eOK == LogGetStats(&stats));
+    bigDump = (uint8_t *)malloc(3 * stats.BufferSize);
+    for (size_t i = 0; i < (3 * stats.BufferSize); i++)
+    {
+        bigDump[i] = (uint8_t)(i * 7);
+    }
+    captureLength = 0;
+    capture[0] = '\0';
+    CHECK(eOK == LOG_DUMP_BUFFER(eLogInfo, bigDump, 3 * stats.BufferSize));
+    CHECK(eOK == LOG(eLogInfo, "after big dump"));
+    CHECK(waitForCapture("after big dump"));
+    CHECK((3 * stats.BufferSize) == captureDump(bigDump));
+    CHECK(NULL != strstr(capture, " bytes, part 1/"));
+    CHECK(NULL != strstr(capture, " bytes, part 2/"));
+    free(bigDump);
+
+    CHECK((eOK == LogGetStats(&stats)) && (0 == stats.MessagesDropped));
+
+    // counting starts over, per sink too
+    CHECK(eOK == LogResetStats());
+    CHECK((eOK == LogGetStats(&stats)) && (0 == stats.MessagesAccepted) && (0 == stats.BytesEnqueued));
+    CHECK((0 == stats.MessagesFiltered) && (0 == sinkStats(&stats, "Capture")->BytesWritten));
+    CHECK(logMarker("after reset"));
+    CHECK((eOK == LogGetStats(&stats)) && (1 == stats.MessagesAccepted) && (sinkStats(&stats, "Capture")->BytesWritten > 0));
+
+    stopLogger(consumer);
+}
+
+static const TestCase       testCases[] = {
+    { "ring",       testRing },
+    { "format",     testFormat },
+    { "deferred",   testDeferred },
+    { "compress",   testCompress },
+    { "file",       testFile },
+    { "ram",        testRam },
+    { "net",        testNet },
+    { "sinks",      testRegistry },
+    { "overflow",   testOverflow },
+    { "lag",        testLag },
+    { "levels",     testLevels },
+    { "isr",        testIsr },
+#if defined(LOG_BATCH_SIZE) && (LOG_BATCH_SIZE > 0)
+    { "batch",      testBatch },
+#endif // LOG_BATCH_SIZE
+    { "logger",     testLogger },
+};
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Set by the logger test, taken when a message is logged
+const char * LogPortTimeGetString()
+{
+    return timeString;
+}
+
+int main(int argc, char ** argv)
+{
+    const TestCase * found = NULL;
+
+    for (size_t i = 0; (argc > 1) && (NULL == found) && (i < ARRAY_SIZE(testCases)); i++)
+    {
+        found = (0 == strcmp(argv[1], testCases[i].Name)) ? &testCases[i] : NULL;
+    }
+
+    if (NULL == found)
+    {
+        fprintf(stderr, "usage: %s <case>, one of:", argv[0]);
+        for (size_t i = 0; i < ARRAY_SIZE(testCases); i++)
+        {
+            fprintf(stderr, " %s", testCases[i].Name);
+        }
+        fprintf(stderr, "\n");
+        return 2;
+    }
+
+    found->Run();
+    printf("%s: %u failed\n", found->Name, failures);
+
+    return (0 == failures) ? 0 : 1;
+}
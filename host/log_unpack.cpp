@@ -0,0 +1,113 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// Host-side decompressor for sinks with eLogSinkFormatCompress: reads the
+// frame stream a sink received (a capture of the UART, a file, a TCP stream)
+// and writes the log text. Bytes that don't form a valid frame - line noise,
+// a capture started mid-frame - are skipped until the next frame, and
+// counted on stderr.
+//
+// usage: log_unpack [input file, stdin by default]
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <globals.h>
+#include "log_compress.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define FRAME_MAX_SIZE      LOG_COMPRESS_BOUND(LOG_COMPRESS_MAX_BLOCK)
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static uint8_t              input[2 * FRAME_MAX_SIZE];
+static uint8_t              output[LOG_COMPRESS_MAX_BLOCK];
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+int main(int argc, char ** argv)
+{
+    FILE * const in = (argc > 1) ? fopen(argv[1], "rb") : stdin;
+    size_t used = 0;
+    size_t skipped = 0;
+    size_t frames = 0;
+    bool done = false;
+
+    if (NULL == in)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    while (!done || (used > 0))
+    {
+        if (!done && (used < FRAME_MAX_SIZE))
+        {
+            // whatever is there, so that a live stream is shown as it comes
+            const ssize_t count = read(fileno(in), &input[used], sizeof(input) - used);
+            used += (count > 0) ? count : 0;
+            done = (count <= 0);
+        }
+
+        const size_t frameSize = LogCompressFrameSize(input, used);
+        size_t consumed = 0;
+
+        if ((0 == frameSize) || (frameSize <= used) || done)
+        {
+            const size_t size = ((0 != frameSize) && (frameSize <= used)) ?
+                    LogDecompress(input, frameSize, output, sizeof(output)) : 0;
+            if (size > 0)
+            {
+                fwrite(output, 1, size, stdout);
+                fflush(stdout);
+                consumed = frameSize;
+                frames++;
+            }
+            else if (used > 0)
+            {
+                consumed = 1;
+                skipped++;
+            }
+        }
+
+        memmove(input, &input[consumed], used - consumed);
+        used -= consumed;
+    }
+
+    fprintf(stderr, "%zu frames, %zu bytes skipped\n", frames, skipped);
+    if (argc > 1)
+    {
+        fclose(in);
+    }
+
+    return 0;
+}
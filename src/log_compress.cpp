@@ -0,0 +1,220 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <string.h>
+
+#include "log_compress.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define MAX_LITERALS        128
+#define MAX_MATCH           (LOG_COMPRESS_MIN_MATCH + 127)
+#define MAX_DISTANCE        0xffff
+#define MATCH_FLAG          0x80
+
+// Multiplicative hash of the next LOG_COMPRESS_MIN_MATCH bytes
+#define HASH(value)         ((uint32_t)((value) * 2654435761u) >> (32 - LOG_COMPRESS_HASH_BITS))
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+// Last position seen for each hash, reset for every block
+static uint16_t             hashTable[1 << LOG_COMPRESS_HASH_BITS];
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static uint32_t read32(const uint8_t * const data)
+{
+    uint32_t retVal;
+
+    memcpy(&retVal, data, sizeof(retVal));
+    return retVal;
+}
+
+static void write16(uint8_t * const data, const size_t value)
+{
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+}
+
+static size_t read16(const uint8_t * const data)
+{
+    return (size_t)data[0] | ((size_t)data[1] << 8);
+}
+
+// Literal runs of up to MAX_LITERALS, false if out is full
+static bool putLiterals(const uint8_t * data, size_t count, uint8_t * const out, const size_t outSize, size_t * const used)
+{
+    bool retVal = true;
+
+    while (retVal && (count > 0))
+    {
+        const size_t run = MIN(count, (size_t)MAX_LITERALS);
+
+        retVal = ((outSize - *used) >= (run + 1));
+        if (retVal)
+        {
+            out[(*used)++] = (uint8_t)(run - 1);
+            memcpy(&out[*used], data, run);
+            *used += run;
+            data += run;
+            count -= run;
+        }
+    }
+
+    return retVal;
+}
+
+static bool putMatch(const size_t length, const size_t distance, uint8_t * const out, const size_t outSize, size_t * const used)
+{
+    bool retVal = ((outSize - *used) >= 3);
+
+    if (retVal)
+    {
+        out[*used] = (uint8_t)(MATCH_FLAG | (length - LOG_COMPRESS_MIN_MATCH));
+        write16(&out[*used + 1], distance);
+        *used += 3;
+    }
+
+    return retVal;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Greedy, one candidate per hash - log lines repeat their headers and most
+// of their text, which even this finds
+size_t LogCompress(const uint8_t * const in, const size_t size, uint8_t * const out, const size_t outSize)
+{
+    // the payload size has to fit its header field
+    const size_t limit = MIN(outSize, (size_t)(LOG_COMPRESS_HEADER_SIZE + LOG_COMPRESS_MAX_PAYLOAD));
+    size_t used = LOG_COMPRESS_HEADER_SIZE;
+    size_t literals = 0;
+    size_t i = 0;
+    bool ok = (size <= LOG_COMPRESS_MAX_BLOCK) && (outSize >= LOG_COMPRESS_HEADER_SIZE);
+
+    memset(hashTable, 0, sizeof(hashTable));
+
+    while (ok && ((i + LOG_COMPRESS_MIN_MATCH) <= size))
+    {
+        const uint32_t value = read32(&in[i]);
+        const size_t hash = HASH(value);
+        const size_t candidate = hashTable[hash];
+
+        hashTable[hash] = (uint16_t)i;
+        if ((candidate < i) && ((i - candidate) <= MAX_DISTANCE) && (read32(&in[candidate]) == value))
+        {
+            size_t length = LOG_COMPRESS_MIN_MATCH;
+            while (((i + length) < size) && (length < MAX_MATCH) && (in[candidate + length] == in[i + length]))
+            {
+                length++;
+            }
+
+            ok = putLiterals(&in[literals], i - literals, out, limit, &used) &&
+                 putMatch(length, i - candidate, out, limit, &used);
+            i += length;
+            literals = i;
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    ok = ok && putLiterals(&in[literals], size - literals, out, limit, &used);
+    if (ok)
+    {
+        out[0] = LOG_COMPRESS_MAGIC;
+        write16(&out[1], size);
+        write16(&out[3], used - LOG_COMPRESS_HEADER_SIZE);
+    }
+
+    return ok ? used : 0;
+}
+
+size_t LogCompressFrameSize(const uint8_t * const in, const size_t size)
+{
+    size_t retVal = 0;
+
+    if ((size >= LOG_COMPRESS_HEADER_SIZE) && (LOG_COMPRESS_MAGIC == in[0]))
+    {
+        retVal = LOG_COMPRESS_HEADER_SIZE + read16(&in[3]);
+    }
+
+    return retVal;
+}
+
+// Every token is checked against both the frame and the output, so garbage
+// is rejected rather than decoded into garbage
+size_t LogDecompress(const uint8_t * const frame, const size_t frameSize, uint8_t * const out, const size_t outSize)
+{
+    const size_t rawSize = (frameSize >= LOG_COMPRESS_HEADER_SIZE) ? read16(&frame[1]) : 0;
+    size_t used = 0;
+    size_t i = LOG_COMPRESS_HEADER_SIZE;
+    bool ok = (frameSize == LogCompressFrameSize(frame, frameSize)) && (rawSize <= outSize);
+
+    while (ok && (i < frameSize))
+    {
+        const uint8_t token = frame[i++];
+
+        if (0 != (token & MATCH_FLAG))
+        {
+            const size_t length = (token & ~MATCH_FLAG) + LOG_COMPRESS_MIN_MATCH;
+            const size_t distance = ((i + 2) <= frameSize) ? read16(&frame[i]) : 0;
+
+            ok = (distance > 0) && (distance <= used) && ((used + length) <= rawSize);
+            for (size_t n = 0; ok && (n < length); n++)
+            {
+                // byte by byte, a match may overlap what it produces
+                out[used + n] = out[used + n - distance];
+            }
+            used += ok ? length : 0;
+            i += 2;
+        }
+        else
+        {
+            const size_t length = (size_t)token + 1;
+
+            ok = ((i + length) <= frameSize) && ((used + length) <= rawSize);
+            if (ok)
+            {
+                memcpy(&out[used], &frame[i], length);
+                used += length;
+            }
+            i += length;
+        }
+    }
+
+    return (ok && (used == rawSize)) ? used : 0;
+}
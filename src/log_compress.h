@@ -0,0 +1,94 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_COMPRESS_H
+#define INC_LOG_COMPRESS_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+// Log text compression, a byte-oriented LZ77 over one block at a time. A
+// frame is self-contained: a header, then tokens that only refer back into
+// the same block, so a decoder needs no state across frames and the encoder
+// no more memory than its hash table
+//
+//  header  LOG_COMPRESS_MAGIC, raw size (16 bit LE), payload size (16 bit LE)
+//  0lllllll                    literal run of l + 1 bytes, which follow
+//  1lllllll, distance (16 bit LE)  copy of l + LOG_COMPRESS_MIN_MATCH bytes
+//                              from distance bytes back in the output
+#define LOG_COMPRESS_MAGIC          0xa5
+#define LOG_COMPRESS_HEADER_SIZE    5
+#define LOG_COMPRESS_MIN_MATCH      4
+#define LOG_COMPRESS_MAX_BLOCK      0xffff
+#define LOG_COMPRESS_MAX_PAYLOAD    0xffff
+
+// Worst case frame size for size bytes of input: all literals
+#define LOG_COMPRESS_BOUND(size)    ((size) + ((size) / 128) + 1 + LOG_COMPRESS_HEADER_SIZE)
+
+// Encoder hash table: 2 << bits bytes of RAM, more finds more matches
+#if !defined(LOG_COMPRESS_HASH_BITS)
+#define LOG_COMPRESS_HASH_BITS      9
+#endif // LOG_COMPRESS_HASH_BITS
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Compresses size bytes, at most LOG_COMPRESS_MAX_BLOCK, into one frame.
+// Returns the frame size, 0 if it didn't fit in outSize or its payload came
+// out larger than LOG_COMPRESS_MAX_PAYLOAD - a block that doesn't compress
+// grows up to LOG_COMPRESS_BOUND(). Uses a static hash table, so it's for one
+// caller at a time - LogTask()
+size_t  LogCompress(const uint8_t * const in, const size_t size, uint8_t * const out, const size_t outSize);
+
+// The size of the frame starting at in, 0 if in doesn't start with a frame
+// header. The frame may be longer than size, then more input is needed
+size_t  LogCompressFrameSize(const uint8_t * const in, const size_t size);
+
+// Decompresses a whole frame. Returns the number of bytes written to out, 0
+// if the frame is corrupt or out too small
+size_t  LogDecompress(const uint8_t * const frame, const size_t frameSize, uint8_t * const out, const size_t outSize);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_COMPRESS_H
@@ -0,0 +1,314 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <stdio.h>
+#include <string.h>
+
+#include "log_deferred.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define NULL_STRING         "(null)"
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static bool packBytes(uint8_t * const buffer, const size_t size, size_t * const used, const void * const value, const size_t valueSize)
+{
+    bool retVal = false;
+
+    if ((size - *used) >= valueSize)
+    {
+        memcpy(&buffer[*used], value, valueSize);
+        *used += valueSize;
+        retVal = true;
+    }
+
+    return retVal;
+}
+
+static bool packString(uint8_t * const buffer, const size_t size, size_t * const used, const char * str, const int precision,
+        bool * const truncated)
+{
+    bool retVal = false;
+    size_t available = size - *used;
+
+    if (NULL == str)
+    {
+        str = NULL_STRING;
+    }
+
+    // length prefix and null-terminator
+    if (available > (sizeof(uint16_t) + 1))
+    {
+        size_t maxLength = available - (sizeof(uint16_t) + 1);
+        if ((precision >= 0) && ((size_t)precision < maxLength))
+        {
+            maxLength = precision;
+        }
+
+        uint16_t length = (uint16_t)strnlen(str, maxLength);
+        if ((length == maxLength) && ('\0' != str[length]) && ((precision < 0) || (length < (size_t)precision)))
+        {
+            *truncated = true;
+        }
+        memcpy(&buffer[*used], &length, sizeof(length));
+        memcpy(&buffer[*used + sizeof(length)], str, length);
+        buffer[*used + sizeof(length) + length] = '\0';
+        *used += sizeof(length) + length + 1;
+        retVal = true;
+    }
+
+    return retVal;
+}
+
+static bool unpackBytes(const uint8_t * const args, const size_t argsSize, size_t * const readPtr, void * const value, const size_t valueSize)
+{
+    bool retVal = false;
+
+    if ((argsSize - *readPtr) >= valueSize)
+    {
+        memcpy(value, &args[*readPtr], valueSize);
+        *readPtr += valueSize;
+        retVal = true;
+    }
+
+    return retVal;
+}
+
+static const char * unpackString(const uint8_t * const args, const size_t argsSize, size_t * const readPtr)
+{
+    const char * retVal = NULL;
+    uint16_t length;
+
+    if (unpackBytes(args, argsSize, readPtr, &length, sizeof(length)))
+    {
+        if ((argsSize - *readPtr) > length)
+        {
+            retVal = (const char *)&args[*readPtr];
+            *readPtr += length + 1;
+        }
+        else
+        {
+            *readPtr = argsSize;
+        }
+    }
+
+    return retVal;
+}
+
+static bool unpackValue(const LogFormatSpec * const spec, const uint8_t * const args, const size_t argsSize, size_t * const readPtr, LogFormatValue * const value)
+{
+    bool retVal = true;
+
+    switch (spec->Arg)
+    {
+        case eLogFormatArgInt:
+        {
+            int raw = 0;
+            retVal = unpackBytes(args, argsSize, readPtr, &raw, sizeof(raw));
+            value->Integer = raw;
+            break;
+        }
+        case eLogFormatArgLong:
+        {
+            long raw = 0;
+            retVal = unpackBytes(args, argsSize, readPtr, &raw, sizeof(raw));
+            value->Integer = raw;
+            break;
+        }
+        case eLogFormatArgLongLong:
+            retVal = unpackBytes(args, argsSize, readPtr, &value->Integer, sizeof(value->Integer));
+            break;
+        case eLogFormatArgDouble:
+        case eLogFormatArgLongDouble:
+            retVal = unpackBytes(args, argsSize, readPtr, &value->Double, sizeof(value->Double));
+            break;
+        case eLogFormatArgPointer:
+            retVal = unpackBytes(args, argsSize, readPtr, &value->Pointer, sizeof(value->Pointer));
+            break;
+        case eLogFormatArgString:
+            value->String = unpackString(args, argsSize, readPtr);
+            retVal = (NULL != value->String);
+            break;
+        default:
+            break;
+    }
+
+    return retVal;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+size_t LogDeferredPack(uint8_t * const buffer, const size_t size, const char * const format, va_list args,
+        bool * const truncated)
+{
+    size_t used = 0;
+    bool fits = true;
+    const char * p = format;
+    LogFormatSpec spec;
+
+    while (fits && (NULL != (p = strchr(p, '%'))))
+    {
+        int precision;
+        p = LogFormatParseSpec(p, &spec);
+
+        precision = spec.Precision;
+        if (spec.WidthStar)
+        {
+            int width = va_arg(args, int);
+            fits = packBytes(buffer, size, &used, &width, sizeof(width));
+        }
+        if (fits && spec.PrecisionStar)
+        {
+            precision = va_arg(args, int);
+            fits = packBytes(buffer, size, &used, &precision, sizeof(precision));
+        }
+
+        if (fits)
+        {
+            switch (spec.Arg)
+            {
+                case eLogFormatArgInt:
+                {
+                    int value = va_arg(args, int);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgLong:
+                {
+                    long value = va_arg(args, long);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgLongLong:
+                {
+                    long long value = va_arg(args, long long);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgDouble:
+                {
+                    double value = va_arg(args, double);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgLongDouble:
+                {
+                    // the formatter works in double precision anyway
+                    double value = (double)va_arg(args, long double);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgPointer:
+                {
+                    void * value = va_arg(args, void *);
+                    fits = packBytes(buffer, size, &used, &value, sizeof(value));
+                    break;
+                }
+                case eLogFormatArgString:
+                    fits = packString(buffer, size, &used, va_arg(args, const char *), precision, truncated);
+                    break;
+                case eLogFormatArgSkip:
+                    (void)va_arg(args, void *);
+                    break;
+                case eLogFormatArgNone:
+                default:
+                    break;
+            }
+        }
+    }
+
+    if (!fits)
+    {
+        *truncated = true;
+    }
+
+    return used;
+}
+
+void LogDeferredRender(LogFormatBuffer * const buffer, const char * const format, const uint8_t * const args, const size_t argsSize)
+{
+    size_t readPtr = 0;
+    bool haveArgs = true;
+    const char * p = format;
+    LogFormatSpec spec;
+    LogFormatValue value;
+
+    while (('\0' != *p) && (buffer->Length < buffer->Size))
+    {
+        if ('%' != *p)
+        {
+            const char * next = strchr(p, '%');
+            const size_t length = (NULL != next) ? (size_t)(next - p) : strlen(p);
+            LogFormatChars(buffer, p, length);
+            p += length;
+            continue;
+        }
+
+        p = LogFormatParseSpec(p, &spec);
+
+        if ((eLogFormatArgNone == spec.Arg) || (eLogFormatArgSkip == spec.Arg))
+        {
+            LogFormatArg(buffer, &spec, &value);
+            continue;
+        }
+
+        // once an argument is missing - it didn't fit when packing - the rest
+        // of them are missing as well
+        if (haveArgs && spec.WidthStar)
+        {
+            haveArgs = unpackBytes(args, argsSize, &readPtr, &spec.Width, sizeof(spec.Width));
+        }
+        if (haveArgs && spec.PrecisionStar)
+        {
+            haveArgs = unpackBytes(args, argsSize, &readPtr, &spec.Precision, sizeof(spec.Precision));
+            if (spec.Precision < 0)
+            {
+                spec.Precision = -1;
+            }
+        }
+        if (haveArgs)
+        {
+            haveArgs = unpackValue(&spec, args, argsSize, &readPtr, &value);
+        }
+        if (haveArgs)
+        {
+            LogFormatArg(buffer, &spec, &value);
+        }
+    }
+}
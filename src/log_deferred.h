@@ -0,0 +1,85 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_DEFERRED_H
+#define INC_LOG_DEFERRED_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <stdarg.h>
+#include <globals.h>
+#include "log_format.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+// Fixed part of a deferred record. Followed by the packed arguments, as
+// produced by LogDeferredPack(). All pointers must stay valid until LogTask()
+// has rendered the record - in practice they are string literals (CMP_NAME,
+// __func__ and the format string)
+typedef struct _LogDeferredHeader
+{
+    uint8_t                 Level;
+    uint8_t                 TimeLength; // chars of time string between header and arguments
+    uint32_t                Time;       // ms, as returned by LogPortGetTimeMs()
+    const char *            Component;
+    const char *            Function;
+    const char *            Format;
+} LogDeferredHeader;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Walks format and copies the raw arguments it references into buffer.
+// Integers, floating point values and pointers are copied as-is, %s strings are
+// copied by value, so the caller's buffers may be reused right after. Returns
+// the number of bytes used; arguments that do not fit are dropped and rendered
+// as empty, a string that fits in part is cut. Either sets truncated, which is
+// left alone otherwise
+size_t  LogDeferredPack(uint8_t * const buffer, const size_t size, const char * const format, va_list args,
+        bool * const truncated);
+
+// Renders format with the arguments packed by LogDeferredPack() into buffer
+void    LogDeferredRender(LogFormatBuffer * const buffer, const char * const format, const uint8_t * const args, const size_t argsSize);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_DEFERRED_H
@@ -0,0 +1,682 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <string.h>
+
+#include "log_format.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define DIGITS_MAX_SIZE     24      // 2^64 in octal, with room to spare
+#define DOUBLE_MAX_SIZE     48      // 1e19 scaled integer part plus fraction
+#define DOUBLE_MAX_PRECISION 15
+#define DOUBLE_MAX_INTEGER  1e19    // beyond that the integer part is scaled down
+#define NULL_STRING         "(null)"
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hexLower[] = "0123456789abcdef";
+static const char hexUpper[] = "0123456789ABCDEF";
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+// Asks Grow for room if count more chars don't fit
+static void makeRoom(LogFormatBuffer * const buffer, const size_t count)
+{
+    if ((count > (buffer->Size - buffer->Length)) && (NULL != buffer->Grow) &&
+        !buffer->Grow(buffer, buffer->Length + count))
+    {
+        buffer->Grow = NULL;
+    }
+}
+
+static void putChars(LogFormatBuffer * const buffer, const char * const chars, const size_t count)
+{
+    makeRoom(buffer, count);
+    size_t toCopy = MIN(count, buffer->Size - buffer->Length);
+
+    memcpy(&buffer->Data[buffer->Length], chars, toCopy);
+    buffer->Length += toCopy;
+}
+
+static void putRepeated(LogFormatBuffer * const buffer, const char c, const size_t count)
+{
+    makeRoom(buffer, count);
+    size_t toFill = MIN(count, buffer->Size - buffer->Length);
+
+    memset(&buffer->Data[buffer->Length], c, toFill);
+    buffer->Length += toFill;
+}
+
+// Both digit writers fill backwards from end and return the first digit
+static char * decimalDigits(char * end, unsigned long long value)
+{
+    // 32-bit divisions are a lot cheaper on the targets that matter
+    while (value > 0xffffffffull)
+    {
+        const unsigned long long quotient = value / 100;
+        const uint32_t pair = (uint32_t)(value - (quotient * 100));
+        end -= 2;
+        memcpy(end, &digitPairs[pair * 2], 2);
+        value = quotient;
+    }
+
+    uint32_t small = (uint32_t)value;
+    while (small >= 100)
+    {
+        const uint32_t quotient = small / 100;
+        const uint32_t pair = small - (quotient * 100);
+        end -= 2;
+        memcpy(end, &digitPairs[pair * 2], 2);
+        small = quotient;
+    }
+
+    if (small >= 10)
+    {
+        end -= 2;
+        memcpy(end, &digitPairs[small * 2], 2);
+    }
+    else
+    {
+        *--end = (char)('0' + small);
+    }
+
+    return end;
+}
+
+static char * radixDigits(char * end, unsigned long long value, const unsigned shift, const char * const digits)
+{
+    const unsigned long long mask = (1u << shift) - 1;
+
+    do
+    {
+        *--end = digits[value & mask];
+        value >>= shift;
+    } while (0 != value);
+
+    return end;
+}
+
+// Lays out [padding][prefix][zeros][body][trailing zeros] or
+// [prefix][zeros][body][trailing zeros][padding]
+static void putField(LogFormatBuffer * const buffer, const LogFormatSpec * const spec,
+        const char * const prefix, const size_t prefixLength, size_t zeros,
+        const char * const body, const size_t bodyLength, const size_t trailingZeros, const bool zeroPadding)
+{
+    bool left = (0 != (spec->Flags & LOG_FORMAT_FLAG_LEFT));
+    size_t width = 0;
+    size_t padding = 0;
+
+    if (spec->Width < 0)
+    {
+        left = true;
+        width = (size_t)(-(long)spec->Width);
+    }
+    else
+    {
+        width = (size_t)spec->Width;
+    }
+
+    const size_t total = prefixLength + zeros + bodyLength + trailingZeros;
+    if (width > total)
+    {
+        padding = width - total;
+    }
+
+    if (!left && zeroPadding && (0 != (spec->Flags & LOG_FORMAT_FLAG_ZERO)))
+    {
+        zeros += padding;
+        padding = 0;
+    }
+
+    if (!left)
+    {
+        putRepeated(buffer, ' ', padding);
+    }
+    putChars(buffer, prefix, prefixLength);
+    putRepeated(buffer, '0', zeros);
+    putChars(buffer, body, bodyLength);
+    putRepeated(buffer, '0', trailingZeros);
+    if (left)
+    {
+        putRepeated(buffer, ' ', padding);
+    }
+}
+
+static void formatInteger(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, long long value)
+{
+    char digits[DIGITS_MAX_SIZE];
+    char * const end = &digits[sizeof(digits)];
+    char * start = end;
+    char prefix[2];
+    size_t prefixLength = 0;
+    size_t zeros = 0;
+    unsigned long long magnitude;
+    const bool isSigned = (('d' == spec->Conversion) || ('i' == spec->Conversion));
+
+    // cut the value back to the size the modifier promised
+    switch (spec->Modifier)
+    {
+        case 'H':
+            value = isSigned ? (long long)(signed char)value : (long long)(unsigned char)value;
+            break;
+        case 'h':
+            value = isSigned ? (long long)(short)value : (long long)(unsigned short)value;
+            break;
+        case 'l':
+        case 'z':
+        case 't':
+            value = isSigned ? (long long)(long)value : (long long)(unsigned long)value;
+            break;
+        case 'q':
+        case 'j':
+            break;
+        default:
+            value = isSigned ? (long long)(int)value : (long long)(unsigned int)value;
+            break;
+    }
+
+    if (isSigned && (value < 0))
+    {
+        magnitude = 0ull - (unsigned long long)value;
+        prefix[prefixLength++] = '-';
+    }
+    else
+    {
+        magnitude = (unsigned long long)value;
+        if (isSigned && (0 != (spec->Flags & LOG_FORMAT_FLAG_PLUS)))
+        {
+            prefix[prefixLength++] = '+';
+        }
+        else if (isSigned && (0 != (spec->Flags & LOG_FORMAT_FLAG_SPACE)))
+        {
+            prefix[prefixLength++] = ' ';
+        }
+    }
+
+    // an explicit zero precision prints nothing for a zero value
+    if ((0 != magnitude) || (0 != spec->Precision))
+    {
+        switch (spec->Conversion)
+        {
+            case 'o':
+                start = radixDigits(end, magnitude, 3, hexLower);
+                break;
+            case 'x':
+                start = radixDigits(end, magnitude, 4, hexLower);
+                break;
+            case 'X':
+                start = radixDigits(end, magnitude, 4, hexUpper);
+                break;
+            default:
+                start = decimalDigits(end, magnitude);
+                break;
+        }
+    }
+
+    const size_t bodyLength = end - start;
+    if ((spec->Precision > 0) && ((size_t)spec->Precision > bodyLength))
+    {
+        zeros = spec->Precision - bodyLength;
+    }
+
+    if (0 != (spec->Flags & LOG_FORMAT_FLAG_ALT))
+    {
+        if (('o' == spec->Conversion) && (0 == zeros) && ((0 == bodyLength) || ('0' != *start)))
+        {
+            zeros = 1;
+        }
+        else if ((('x' == spec->Conversion) || ('X' == spec->Conversion)) && (0 != magnitude))
+        {
+            prefix[prefixLength++] = '0';
+            prefix[prefixLength++] = spec->Conversion;
+        }
+    }
+
+    putField(buffer, spec, prefix, prefixLength, zeros, start, bodyLength, 0, (spec->Precision < 0));
+}
+
+static void formatPointer(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, const void * const value)
+{
+    char digits[DIGITS_MAX_SIZE];
+    char * const end = &digits[sizeof(digits)];
+    char * const start = radixDigits(end, (uintptr_t)value, 4, hexLower);
+
+    putField(buffer, spec, "0x", 2, 0, start, end - start, 0, true);
+}
+
+static void formatDouble(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, double value)
+{
+    char digits[DOUBLE_MAX_SIZE];
+    char * const end = &digits[sizeof(digits)];
+    char * start = end;
+    char prefix = 0;
+    const bool upper = (('F' == spec->Conversion) || ('E' == spec->Conversion) ||
+                        ('G' == spec->Conversion) || ('A' == spec->Conversion));
+
+    if (value < 0)
+    {
+        prefix = '-';
+        value = -value;
+    }
+    else if (0 != (spec->Flags & LOG_FORMAT_FLAG_PLUS))
+    {
+        prefix = '+';
+    }
+    else if (0 != (spec->Flags & LOG_FORMAT_FLAG_SPACE))
+    {
+        prefix = ' ';
+    }
+
+    if (value != value)
+    {
+        putField(buffer, spec, &prefix, (0 != prefix) ? 1 : 0, 0, upper ? "NAN" : "nan", 3, 0, false);
+    }
+    else if ((value - value) != 0)
+    {
+        putField(buffer, spec, &prefix, (0 != prefix) ? 1 : 0, 0, upper ? "INF" : "inf", 3, 0, false);
+    }
+    else
+    {
+        int precision = (spec->Precision < 0) ? 6 : MIN(spec->Precision, DOUBLE_MAX_PRECISION);
+        size_t scaledZeros = 0;
+        unsigned long long scale = 1;
+
+        // keep the integer part within 64 bits, the digits lost this way are
+        // beyond double precision anyway
+        while (value >= DOUBLE_MAX_INTEGER)
+        {
+            value /= 10;
+            scaledZeros++;
+        }
+        if (scaledZeros > 0)
+        {
+            precision = 0;
+        }
+
+        for (int i = 0; i < precision; i++)
+        {
+            scale *= 10;
+        }
+
+        unsigned long long integer = (unsigned long long)value;
+        unsigned long long fraction = (unsigned long long)(((value - (double)integer) * (double)scale) + 0.5);
+        if (fraction >= scale)
+        {
+            integer++;
+            fraction -= scale;
+        }
+
+        if (precision > 0)
+        {
+            char * fractionStart = decimalDigits(end, fraction);
+            while ((end - fractionStart) < precision)
+            {
+                *--fractionStart = '0';
+            }
+            start = fractionStart;
+        }
+        if ((precision > 0) || (0 != (spec->Flags & LOG_FORMAT_FLAG_ALT)))
+        {
+            *--start = '.';
+        }
+        start = decimalDigits(start, integer);
+
+        putField(buffer, spec, &prefix, (0 != prefix) ? 1 : 0, 0, start, end - start, scaledZeros, true);
+    }
+}
+
+static void formatString(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, const char * str)
+{
+    if (NULL == str)
+    {
+        str = NULL_STRING;
+    }
+
+    const size_t length = (spec->Precision >= 0) ? strnlen(str, spec->Precision) : strlen(str);
+    putField(buffer, spec, "", 0, 0, str, length, 0, false);
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+void LogFormatInit(LogFormatBuffer * const buffer, char * const data, const size_t size)
+{
+    buffer->Data = data;
+    buffer->Size = size;
+    buffer->Length = 0;
+    buffer->Grow = NULL;
+    buffer->Context = NULL;
+}
+
+void LogFormatChar(LogFormatBuffer * const buffer, const char c)
+{
+    makeRoom(buffer, 1);
+    if (buffer->Length < buffer->Size)
+    {
+        buffer->Data[buffer->Length++] = c;
+    }
+}
+
+void LogFormatChars(LogFormatBuffer * const buffer, const char * const chars, const size_t count)
+{
+    putChars(buffer, chars, count);
+}
+
+void LogFormatString(LogFormatBuffer * const buffer, const char * const str)
+{
+    putChars(buffer, str, strlen(str));
+}
+
+// Zero-padded to digits, the fixed-width fields of the header
+void LogFormatDecimal(LogFormatBuffer * const buffer, const uint32_t value, const size_t digits)
+{
+    char text[DIGITS_MAX_SIZE];
+    char * const end = &text[sizeof(text)];
+    const char * const start = decimalDigits(end, value);
+    const size_t length = end - start;
+
+    if (digits > length)
+    {
+        putRepeated(buffer, '0', digits - length);
+    }
+    putChars(buffer, start, length);
+}
+
+const char * LogFormatParseSpec(const char * const format, LogFormatSpec * const spec)
+{
+    const char * p = format + 1;
+    bool flags = true;
+
+    spec->Start = format;
+    spec->Flags = 0;
+    spec->Modifier = 0;
+    spec->Conversion = 0;
+    spec->WidthStar = false;
+    spec->PrecisionStar = false;
+    spec->Width = 0;
+    spec->Precision = -1;
+    spec->Arg = eLogFormatArgNone;
+
+    while (flags)
+    {
+        switch (*p)
+        {
+            case '-':   spec->Flags |= LOG_FORMAT_FLAG_LEFT;    p++;    break;
+            case '+':   spec->Flags |= LOG_FORMAT_FLAG_PLUS;    p++;    break;
+            case ' ':   spec->Flags |= LOG_FORMAT_FLAG_SPACE;   p++;    break;
+            case '#':   spec->Flags |= LOG_FORMAT_FLAG_ALT;     p++;    break;
+            case '0':   spec->Flags |= LOG_FORMAT_FLAG_ZERO;    p++;    break;
+            default:    flags = false;                                  break;
+        }
+    }
+
+    if ('*' == *p)
+    {
+        spec->WidthStar = true;
+        p++;
+    }
+    while ((*p >= '0') && (*p <= '9'))
+    {
+        spec->Width = (spec->Width * 10) + (*p - '0');
+        p++;
+    }
+
+    if ('.' == *p)
+    {
+        p++;
+        spec->Precision = 0;
+        if ('*' == *p)
+        {
+            spec->PrecisionStar = true;
+            p++;
+        }
+        while ((*p >= '0') && (*p <= '9'))
+        {
+            spec->Precision = (spec->Precision * 10) + (*p - '0');
+            p++;
+        }
+    }
+
+    switch (*p)
+    {
+        case 'h':
+            p++;
+            spec->Modifier = 'h';
+            if ('h' == *p)
+            {
+                p++;
+                spec->Modifier = 'H';
+            }
+            break;
+        case 'l':
+            p++;
+            spec->Modifier = 'l';
+            if ('l' == *p)
+            {
+                p++;
+                spec->Modifier = 'q';
+            }
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+        case 'L':
+            spec->Modifier = *p++;
+            break;
+        default:
+            break;
+    }
+
+    spec->Conversion = *p;
+    switch (*p)
+    {
+        case 'c':
+            spec->Arg = eLogFormatArgInt;
+            break;
+        case 'd':
+        case 'i':
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            switch (spec->Modifier)
+            {
+                // size_t and ptrdiff_t are long-sized on both ILP32 and LP64
+                case 'l':
+                case 'z':
+                case 't':
+                    spec->Arg = eLogFormatArgLong;
+                    break;
+                case 'q':
+                case 'j':
+                    spec->Arg = eLogFormatArgLongLong;
+                    break;
+                default:
+                    spec->Arg = eLogFormatArgInt;
+                    break;
+            }
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            spec->Arg = ('L' == spec->Modifier) ? eLogFormatArgLongDouble : eLogFormatArgDouble;
+            break;
+        case 'p':
+            spec->Arg = eLogFormatArgPointer;
+            break;
+        case 's':
+            spec->Arg = (0 == spec->Modifier) ? eLogFormatArgString : eLogFormatArgSkip;
+            break;
+        case 'n':
+            spec->Arg = eLogFormatArgSkip;
+            break;
+        default:
+            break;
+    }
+
+    if ('\0' != *p)
+    {
+        p++;
+    }
+
+    spec->Length = p - format;
+    return p;
+}
+
+void LogFormatArg(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, const LogFormatValue * const value)
+{
+    switch (spec->Arg)
+    {
+        case eLogFormatArgInt:
+        case eLogFormatArgLong:
+        case eLogFormatArgLongLong:
+            if ('c' == spec->Conversion)
+            {
+                const char c = (char)value->Integer;
+                putField(buffer, spec, "", 0, 0, &c, 1, 0, false);
+            }
+            else
+            {
+                formatInteger(buffer, spec, value->Integer);
+            }
+            break;
+        case eLogFormatArgDouble:
+        case eLogFormatArgLongDouble:
+            formatDouble(buffer, spec, value->Double);
+            break;
+        case eLogFormatArgPointer:
+            formatPointer(buffer, spec, value->Pointer);
+            break;
+        case eLogFormatArgString:
+            formatString(buffer, spec, value->String);
+            break;
+        case eLogFormatArgSkip:
+            break;
+        case eLogFormatArgNone:
+        default:
+            // "%%" and anything we don't understand go out verbatim
+            if ('%' == spec->Conversion)
+            {
+                LogFormatChar(buffer, '%');
+            }
+            else
+            {
+                putChars(buffer, spec->Start, spec->Length);
+            }
+            break;
+    }
+}
+
+void LogFormatV(LogFormatBuffer * const buffer, const char * const format, va_list args)
+{
+    const char * p = format;
+    LogFormatSpec spec;
+    LogFormatValue value;
+
+    while (('\0' != *p) && ((buffer->Length < buffer->Size) || (NULL != buffer->Grow)))
+    {
+        if ('%' != *p)
+        {
+            const char * next = strchr(p, '%');
+            const size_t length = (NULL != next) ? (size_t)(next - p) : strlen(p);
+            putChars(buffer, p, length);
+            p += length;
+            continue;
+        }
+
+        p = LogFormatParseSpec(p, &spec);
+
+        if (spec.WidthStar)
+        {
+            spec.Width = va_arg(args, int);
+        }
+        if (spec.PrecisionStar)
+        {
+            spec.Precision = va_arg(args, int);
+            if (spec.Precision < 0)
+            {
+                spec.Precision = -1;
+            }
+        }
+
+        switch (spec.Arg)
+        {
+            case eLogFormatArgInt:
+                value.Integer = va_arg(args, int);
+                break;
+            case eLogFormatArgLong:
+                value.Integer = va_arg(args, long);
+                break;
+            case eLogFormatArgLongLong:
+                value.Integer = va_arg(args, long long);
+                break;
+            case eLogFormatArgDouble:
+                value.Double = va_arg(args, double);
+                break;
+            case eLogFormatArgLongDouble:
+                value.Double = (double)va_arg(args, long double);
+                break;
+            case eLogFormatArgPointer:
+            case eLogFormatArgSkip:
+                value.Pointer = va_arg(args, const void *);
+                break;
+            case eLogFormatArgString:
+                value.String = va_arg(args, const char *);
+                break;
+            case eLogFormatArgNone:
+            default:
+                break;
+        }
+
+        LogFormatArg(buffer, &spec, &value);
+    }
+}
@@ -0,0 +1,133 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_FORMAT_H
+#define INC_LOG_FORMAT_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <stdarg.h>
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define LOG_FORMAT_FLAG_LEFT        0x01    // '-'
+#define LOG_FORMAT_FLAG_PLUS        0x02    // '+'
+#define LOG_FORMAT_FLAG_SPACE       0x04    // ' '
+#define LOG_FORMAT_FLAG_ALT         0x08    // '#'
+#define LOG_FORMAT_FLAG_ZERO        0x10    // '0'
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+typedef struct _LogFormatBuffer LogFormatBuffer;
+
+// Asked for room for size chars in total when a write doesn't fit. Updates
+// Data and Size, and may grant less than asked for. Returns false if it
+// granted less, or could not grow the buffer at all
+typedef bool (*LogFormatGrowFn)(LogFormatBuffer * const buffer, const size_t size);
+
+// Output cursor. Writes past Size are silently dropped, unless Grow makes room
+// for them - once it fails it is cleared and not asked again. The output is
+// not null-terminated
+struct _LogFormatBuffer
+{
+    char *                  Data;
+    size_t                  Size;
+    size_t                  Length;
+    LogFormatGrowFn         Grow;           // optional, NULL after LogFormatInit()
+    void *                  Context;        // for Grow, unused by the formatter
+};
+
+// What a conversion consumes from the argument list
+typedef enum _eLogFormatArg
+{
+    eLogFormatArgNone,          // %% and unknown conversions - nothing
+    eLogFormatArgInt,
+    eLogFormatArgLong,
+    eLogFormatArgLongLong,
+    eLogFormatArgDouble,
+    eLogFormatArgLongDouble,
+    eLogFormatArgPointer,
+    eLogFormatArgString,
+    eLogFormatArgSkip,          // consumed, but never printed (%n, %ls)
+} eLogFormatArg;
+
+typedef struct _LogFormatSpec
+{
+    const char *            Start;          // the '%'
+    size_t                  Length;         // up to and including the conversion
+    uint8_t                 Flags;          // LOG_FORMAT_FLAG_*
+    char                    Modifier;       // 'H' for hh, 'h', 'l', 'q' for ll, 'j', 'z', 't', 'L' or 0
+    char                    Conversion;
+    bool                    WidthStar;
+    bool                    PrecisionStar;
+    int                     Width;
+    int                     Precision;      // -1 if not given
+    eLogFormatArg           Arg;
+} LogFormatSpec;
+
+// A single argument, as read according to LogFormatSpec.Arg
+typedef union _LogFormatValue
+{
+    long long               Integer;
+    double                  Double;
+    const void *            Pointer;
+    const char *            String;
+} LogFormatValue;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+void            LogFormatInit(LogFormatBuffer * const buffer, char * const data, const size_t size);
+void            LogFormatChar(LogFormatBuffer * const buffer, const char c);
+void            LogFormatChars(LogFormatBuffer * const buffer, const char * const chars, const size_t count);
+void            LogFormatString(LogFormatBuffer * const buffer, const char * const str);
+void            LogFormatDecimal(LogFormatBuffer * const buffer, const uint32_t value, const size_t digits);
+
+// printf subset: flags "-+ #0", width, precision (both may be '*'), length
+// modifiers hh h l ll j z t L and conversions d i u o x X c s p f F %.
+// e E g G a A are accepted but rendered like f
+void            LogFormatV(LogFormatBuffer * const buffer, const char * const format, va_list args);
+
+// Building blocks for renderers that don't take their arguments from a va_list
+const char *    LogFormatParseSpec(const char * const format, LogFormatSpec * const spec);
+void            LogFormatArg(LogFormatBuffer * const buffer, const LogFormatSpec * const spec, const LogFormatValue * const value);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_FORMAT_H
@@ -0,0 +1,352 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <string.h>
+
+#include "log_ring.h"
+#include "logger_port.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+// Record header: payload size, record type and the committed flag
+#define HEADER_SIZE_MASK    0x0000ffffu
+#define HEADER_TYPE_SHIFT   16
+#define HEADER_TYPE_MASK    0x000000ffu
+#define HEADER_COMMITTED    0x80000000u
+
+#define TYPE_PADDING        0xff
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static uint32_t recordSpan(const size_t size)
+{
+    return (uint32_t)((size + LOG_RING_HEADER_SIZE + (LOG_RING_ALIGN - 1)) & ~(size_t)(LOG_RING_ALIGN - 1));
+}
+
+static uint32_t * headerAt(const LogRing * const ring, const uint32_t position)
+{
+    return (uint32_t *)&ring->Buffer[position & (ring->Size - 1)];
+}
+
+// Whether the reserved record at offset with the given span is the last one,
+// i.e. head is right behind it. An unconsumed record keeps Head from getting a
+// full lap ahead, so comparing buffer offsets is enough
+static bool isLastRecord(const LogRing * const ring, const uint32_t offset, const uint32_t span, const uint32_t head)
+{
+    return (((head - span) & (ring->Size - 1)) == offset);
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+eStatus LogRingInit(LogRing * const ring, uint8_t * const buffer, const size_t size)
+{
+    eStatus retVal = eOK;
+
+    if ((NULL == ring) || (NULL == buffer) ||
+        (size < LOG_RING_ALIGN) || (size > (HEADER_SIZE_MASK + 1)) || (0 != (size & (size - 1))) ||
+        (0 != ((uintptr_t)buffer & (LOG_RING_ALIGN - 1))))
+    {
+        retVal = eINVALIDARG;
+    }
+    else
+    {
+        memset(buffer, 0, size);
+        ring->Buffer = buffer;
+        ring->Size = (uint32_t)size;
+        ring->Head = 0;
+        ring->Tail = 0;
+    }
+
+    return retVal;
+}
+
+LOG_PORT_ISR_ATTR uint8_t * LogRingReserve(LogRing * const ring, const size_t size)
+{
+    uint8_t * retVal = NULL;
+    const uint32_t span = recordSpan(size);
+    uint32_t head = __atomic_load_n(&ring->Head, __ATOMIC_RELAXED);
+    uint32_t pad = 0;
+    bool reserved = false;
+
+    if ((size <= HEADER_SIZE_MASK) && (span <= ring->Size))
+    {
+        do
+        {
+            const uint32_t tail = __atomic_load_n(&ring->Tail, __ATOMIC_ACQUIRE);
+            const uint32_t toEnd = ring->Size - (head & (ring->Size - 1));
+
+            // records never wrap, pad to the end of the buffer instead
+            pad = (span > toEnd) ? toEnd : 0;
+            if (((head - tail) + pad + span) > ring->Size)
+            {
+                break;
+            }
+
+            reserved = __atomic_compare_exchange_n(&ring->Head, &head, head + pad + span, true,
+                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        } while (!reserved);
+    }
+
+    if (reserved)
+    {
+        if (pad > 0)
+        {
+            __atomic_store_n(headerAt(ring, head),
+                    (pad - LOG_RING_HEADER_SIZE) | (TYPE_PADDING << HEADER_TYPE_SHIFT) | HEADER_COMMITTED,
+                    __ATOMIC_RELEASE);
+            head += pad;
+        }
+
+        // size only, the consumer ignores it until the committed flag is set
+        uint32_t * header = headerAt(ring, head);
+        __atomic_store_n(header, (uint32_t)size, __ATOMIC_RELAXED);
+        retVal = (uint8_t *)(header + 1);
+    }
+
+    return retVal;
+}
+
+LOG_PORT_ISR_ATTR void LogRingCommit(LogRing * const ring, uint8_t * const record, const uint8_t type)
+{
+    uint32_t * header = ((uint32_t *)record) - 1;
+    const uint32_t size = __atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK;
+
+    (void)ring;
+
+    __atomic_store_n(header, size | ((uint32_t)type << HEADER_TYPE_SHIFT) | HEADER_COMMITTED, __ATOMIC_RELEASE);
+}
+
+LOG_PORT_ISR_ATTR uint8_t * LogRingExtend(LogRing * const ring, uint8_t * const record, const size_t size)
+{
+    uint8_t * retVal = NULL;
+    uint32_t * header = ((uint32_t *)record) - 1;
+    const uint32_t offset = (uint32_t)((uint8_t *)header - ring->Buffer);
+    const size_t oldSize = __atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK;
+    const uint32_t oldSpan = recordSpan(oldSize);
+    const uint32_t span = recordSpan(size);
+    const uint32_t toEnd = ring->Size - offset;
+    uint32_t head = __atomic_load_n(&ring->Head, __ATOMIC_RELAXED);
+    bool extended = false;
+
+    if ((size <= HEADER_SIZE_MASK) && (size >= oldSize))
+    {
+        // a failed CAS means someone reserved after us, which ends the loop
+        while (!extended && isLastRecord(ring, offset, oldSpan, head))
+        {
+            const uint32_t tail = __atomic_load_n(&ring->Tail, __ATOMIC_ACQUIRE);
+            const uint32_t end = (head - oldSpan) + ((span > toEnd) ? toEnd : 0) + span;
+
+            if ((end - tail) > ring->Size)
+            {
+                break;
+            }
+
+            extended = __atomic_compare_exchange_n(&ring->Head, &head, end, true,
+                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (extended && (span > toEnd))
+    {
+        // The start of the buffer is free or the CAS would have failed. The
+        // old place turns into padding only once the contents are out of it
+        uint32_t * moved = (uint32_t *)ring->Buffer;
+        __atomic_store_n(moved, (uint32_t)size, __ATOMIC_RELAXED);
+        memcpy(moved + 1, record, oldSize);
+        __atomic_store_n(header,
+                (toEnd - LOG_RING_HEADER_SIZE) | (TYPE_PADDING << HEADER_TYPE_SHIFT) | HEADER_COMMITTED,
+                __ATOMIC_RELEASE);
+        retVal = (uint8_t *)(moved + 1);
+    }
+    else if (extended)
+    {
+        __atomic_store_n(header, (uint32_t)size, __ATOMIC_RELAXED);
+        retVal = record;
+    }
+
+    return retVal;
+}
+
+LOG_PORT_ISR_ATTR void LogRingTrim(LogRing * const ring, uint8_t * const record, const size_t size)
+{
+    uint32_t * header = ((uint32_t *)record) - 1;
+    const uint32_t offset = (uint32_t)((uint8_t *)header - ring->Buffer);
+    const size_t oldSize = __atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK;
+    const uint32_t oldSpan = recordSpan(oldSize);
+    const uint32_t span = recordSpan(size);
+    uint32_t head = __atomic_load_n(&ring->Head, __ATOMIC_RELAXED);
+    bool returned = false;
+
+    if (size < oldSize)
+    {
+        while (!returned && isLastRecord(ring, offset, oldSpan, head))
+        {
+            returned = __atomic_compare_exchange_n(&ring->Head, &head, (head - oldSpan) + span, true,
+                    __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+        }
+
+        // Stored before the record gets committed, so the consumer never gets
+        // to see the padding without its header
+        if (!returned && (span < oldSpan))
+        {
+            __atomic_store_n((uint32_t *)((uint8_t *)header + span),
+                    (oldSpan - span - LOG_RING_HEADER_SIZE) | (TYPE_PADDING << HEADER_TYPE_SHIFT) | HEADER_COMMITTED,
+                    __ATOMIC_RELEASE);
+        }
+
+        __atomic_store_n(header, (uint32_t)size, __ATOMIC_RELAXED);
+    }
+}
+
+LOG_PORT_ISR_ATTR bool LogRingIsLast(const LogRing * const ring, const uint8_t * const record)
+{
+    const uint32_t * header = ((const uint32_t *)record) - 1;
+    const uint32_t offset = (uint32_t)((const uint8_t *)header - ring->Buffer);
+    const uint32_t span = recordSpan(__atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK);
+
+    return isLastRecord(ring, offset, span, __atomic_load_n(&ring->Head, __ATOMIC_RELAXED));
+}
+
+LOG_PORT_ISR_ATTR void LogRingDiscard(LogRing * const ring, uint8_t * const record)
+{
+    const uint32_t * header = ((const uint32_t *)record) - 1;
+
+    // Trim wants the bytes it gives back untouched
+    memset(record, 0, __atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK);
+    LogRingTrim(ring, record, 0);
+    LogRingCommit(ring, record, TYPE_PADDING);
+}
+
+LOG_PORT_ISR_ATTR uint8_t * LogRingSplit(LogRing * const ring, uint8_t * const record, const size_t size)
+{
+    uint8_t * retVal = NULL;
+    uint32_t * header = ((uint32_t *)record) - 1;
+    const size_t oldSize = __atomic_load_n(header, __ATOMIC_RELAXED) & HEADER_SIZE_MASK;
+    const uint32_t oldSpan = recordSpan(oldSize);
+    const uint32_t span = recordSpan(size);
+
+    (void)ring;
+
+    // the rest's header goes in before the record can be committed, so the
+    // consumer stops there like at any reserved record
+    if ((size <= oldSize) && (span < oldSpan))
+    {
+        uint32_t * rest = (uint32_t *)((uint8_t *)header + span);
+        __atomic_store_n(rest, oldSpan - span - LOG_RING_HEADER_SIZE, __ATOMIC_RELAXED);
+        __atomic_store_n(header, (uint32_t)size, __ATOMIC_RELAXED);
+        retVal = (uint8_t *)(rest + 1);
+    }
+
+    return retVal;
+}
+
+const uint8_t * LogRingPeek(LogRing * const ring, size_t * const size, uint8_t * const type)
+{
+    uint32_t position = ring->Tail;
+    const uint8_t * retVal = LogRingPeekAt(ring, &position, size, type);
+
+    // padding is of no use to anyone
+    LogRingConsumeTo(ring, position);
+
+    return retVal;
+}
+
+void LogRingConsume(LogRing * const ring)
+{
+    LogRingConsumeTo(ring, LogRingNext(ring, ring->Tail));
+}
+
+const uint8_t * LogRingPeekAt(const LogRing * const ring, uint32_t * const position, size_t * const size, uint8_t * const type)
+{
+    const uint8_t * retVal = NULL;
+
+    while (NULL == retVal)
+    {
+        const uint32_t * header = headerAt(ring, *position);
+        const uint32_t value = __atomic_load_n(header, __ATOMIC_ACQUIRE);
+
+        // a full ring wraps onto its own oldest record one lap ahead
+        if ((0 == (value & HEADER_COMMITTED)) ||
+            ((*position - __atomic_load_n(&ring->Tail, __ATOMIC_RELAXED)) >= ring->Size))
+        {
+            break;
+        }
+        else if (TYPE_PADDING == ((value >> HEADER_TYPE_SHIFT) & HEADER_TYPE_MASK))
+        {
+            *position += recordSpan(value & HEADER_SIZE_MASK);
+        }
+        else
+        {
+            *size = value & HEADER_SIZE_MASK;
+            *type = (uint8_t)((value >> HEADER_TYPE_SHIFT) & HEADER_TYPE_MASK);
+            retVal = (const uint8_t *)(header + 1);
+        }
+    }
+
+    return retVal;
+}
+
+uint32_t LogRingNext(const LogRing * const ring, const uint32_t position)
+{
+    return position + recordSpan(__atomic_load_n(headerAt(ring, position), __ATOMIC_RELAXED) & HEADER_SIZE_MASK);
+}
+
+void LogRingConsumeTo(LogRing * const ring, const uint32_t position)
+{
+    if ((int32_t)(position - ring->Tail) > 0)
+    {
+        LogRingClear(ring, ring->Tail, position);
+        LogRingRelease(ring, position);
+    }
+}
+
+void LogRingClear(const LogRing * const ring, const uint32_t from, const uint32_t to)
+{
+    const uint32_t offset = from & (ring->Size - 1);
+    const uint32_t count = ((int32_t)(to - from) > 0) ? (to - from) : 0;
+    const uint32_t toEnd = ring->Size - offset;
+
+    // keep the invariant that unreserved space reads as zero
+    memset(&ring->Buffer[offset], 0, (count > toEnd) ? toEnd : count);
+    memset(ring->Buffer, 0, (count > toEnd) ? (count - toEnd) : 0);
+}
+
+void LogRingRelease(LogRing * const ring, const uint32_t position)
+{
+    __atomic_store_n(&ring->Tail, position, __ATOMIC_RELEASE);
+}
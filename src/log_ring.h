@@ -0,0 +1,120 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_RING_H
+#define INC_LOG_RING_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define LOG_RING_ALIGN          4
+#define LOG_RING_HEADER_SIZE    sizeof(uint32_t)
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+// Lock-free multi-producer / single-consumer ring of variable sized records.
+// Producers claim space by CAS-ing Head forward, fill it in and then commit the
+// record header. The consumer walks from Tail, stops at the first record that
+// is not committed yet and zeroes whatever it consumes, so a reserved but not
+// yet committed header always reads as zero. Records never wrap - a padding
+// record fills the end of the buffer instead.
+// Positions are free running and only masked when indexing Buffer, so Size
+// must be a power of two
+typedef struct _LogRing
+{
+    uint8_t *               Buffer;
+    uint32_t                Size;
+    volatile uint32_t       Head;       // next free position, producers only
+    volatile uint32_t       Tail;       // oldest unconsumed position, consumer only
+} LogRing;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+eStatus     LogRingInit(LogRing * const ring, uint8_t * const buffer, const size_t size);
+
+// Producer side, safe from any number of tasks at once. Reserve returns NULL if
+// the ring has no room for size bytes. Every successful Reserve must be
+// followed by a Commit, or the consumer stalls on that record
+uint8_t *   LogRingReserve(LogRing * const ring, const size_t size);
+void        LogRingCommit(LogRing * const ring, uint8_t * const record, const uint8_t type);
+
+// Resizing a record between Reserve and Commit. Extend grows it to size bytes,
+// which only works while nothing was reserved after it. A record that would no
+// longer fit before the end of the buffer moves to its start, contents and
+// all. Returns the record, possibly moved, or NULL if it stays as it was.
+// Trim shrinks it to size bytes and gives the rest back, or pads it if another
+// record follows already. Bytes past size must not have been written to
+uint8_t *   LogRingExtend(LogRing * const ring, uint8_t * const record, const size_t size);
+void        LogRingTrim(LogRing * const ring, uint8_t * const record, const size_t size);
+// Whether nothing was reserved after record yet, so that Extend can only fail
+// for lack of room
+bool        LogRingIsLast(const LogRing * const ring, const uint8_t * const record);
+// Instead of a Commit: drops the record, whatever was written to it, and gives
+// back what it can. The consumer skips what's left like padding
+void        LogRingDiscard(LogRing * const ring, uint8_t * const record);
+// Cuts a record after size bytes. The rest becomes a reserved record of its
+// own, right behind it, which is returned - or NULL if there is no room left
+// for one. Both are committed like any other record, so that a series of them
+// can be reserved at once. Bytes past size must not have been written to
+uint8_t *   LogRingSplit(LogRing * const ring, uint8_t * const record, const size_t size);
+
+// Consumer side, a single task only. Peek returns the oldest committed record
+// and leaves it in place until Consume, or NULL if there is none
+const uint8_t * LogRingPeek(LogRing * const ring, size_t * const size, uint8_t * const type);
+void        LogRingConsume(LogRing * const ring);
+
+// Consumer side with several readers, each at a position of its own. PeekAt
+// returns the committed record at *position, moving it past any padding first,
+// or NULL. Next is the position of the record following the one at position.
+// ConsumeTo consumes everything before position, which no reader may be behind
+const uint8_t * LogRingPeekAt(const LogRing * const ring, uint32_t * const position, size_t * const size, uint8_t * const type);
+uint32_t    LogRingNext(const LogRing * const ring, const uint32_t position);
+void        LogRingConsumeTo(LogRing * const ring, const uint32_t position);
+// ConsumeTo in two steps, for consumers taking turns under a lock of their own.
+// Clear zeroes the records from position from up to to, which are done with,
+// Release then hands everything before position back to the producers
+void        LogRingClear(const LogRing * const ring, const uint32_t from, const uint32_t to);
+void        LogRingRelease(LogRing * const ring, const uint32_t position);
+
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_RING_H
@@ -0,0 +1,260 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// File sink on the plain POSIX file API, so the same code runs on the ESP-IDF
+// VFS (SPIFFS, LittleFS, FAT) and on a host. Flash file systems do worst with
+// small writes at odd offsets, so the data is gathered in a block buffer and
+// goes to the file a whole block at a time, at block-aligned offsets
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log_sink_file.h"
+#include "log_format.h"
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#if (0 != (LOG_FILE_MAX_SIZE % LOG_FILE_BLOCK_SIZE))
+#error "LOG_FILE_MAX_SIZE must be a multiple of LOG_FILE_BLOCK_SIZE"
+#endif
+#if (LOG_FILE_COUNT < 1)
+#error "LOG_FILE_COUNT must be at least 1"
+#endif
+
+// The path and a ".N" suffix of up to 10 digits
+#define FILE_NAME_SIZE      (LOG_FILE_PATH_SIZE + 11)
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static char                 filePath[LOG_FILE_PATH_SIZE] = { 0 };
+static int                  fileFd = -1;
+static uint8_t              fileBlock[LOG_FILE_BLOCK_SIZE] __attribute__((aligned(4)));
+static size_t               blockUsed = 0;      // bytes in fileBlock
+static size_t               blockWritten = 0;   // of those, in the file already
+static off_t                blockOffset = 0;    // of fileBlock in the file
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+const LogSink               LogSinkFile = { "File", LogSinkFileInit, LogSinkFileGetWriteSize, LogSinkFileWrite, LogSinkFileFlush };
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static bool fileOpen(const int flags);
+
+// The path for index 0, path.index for the rotated files
+static const char * fileName(char * const name, const size_t index)
+{
+    LogFormatBuffer out;
+
+    LogFormatInit(&out, name, FILE_NAME_SIZE - 1);
+    LogFormatString(&out, filePath);
+    if (index > 0)
+    {
+        LogFormatChar(&out, '.');
+        LogFormatDecimal(&out, index, 0);
+    }
+    name[out.Length] = '\0';
+
+    return name;
+}
+
+// Whatever is in the block and not in the file yet is lost
+static void fileClose(void)
+{
+    if (fileFd >= 0)
+    {
+        close(fileFd);
+    }
+    fileFd = -1;
+    blockUsed = 0;
+    blockWritten = 0;
+}
+
+// Writes the block at its place in the file, as far as it is filled. A block
+// written partially by a flush is written again whole, never appended to
+static bool blockWrite(void)
+{
+    bool retVal = (blockOffset == lseek(fileFd, blockOffset, SEEK_SET)) &&
+                  ((ssize_t)blockUsed == write(fileFd, fileBlock, blockUsed));
+
+    if (retVal)
+    {
+        blockWritten = blockUsed;
+    }
+    else
+    {
+        fileClose();
+    }
+
+    return retVal;
+}
+
+// Shifts path.N to path.N+1, the oldest file goes, and starts an empty one.
+// Missing files are no error, there are fewer of them until rotated enough
+static bool fileRotate(void)
+{
+    char from[FILE_NAME_SIZE];
+    char to[FILE_NAME_SIZE];
+
+    fileClose();
+    unlink(fileName(to, LOG_FILE_COUNT - 1));
+    for (size_t i = LOG_FILE_COUNT - 1; i > 0; i--)
+    {
+        rename(fileName(from, i - 1), fileName(to, i));
+    }
+
+    return fileOpen(O_TRUNC);
+}
+
+// Picks up where the file ends. A partial last block is read back into the
+// block buffer, so that it gets completed and written again in place
+static bool fileOpen(const int flags)
+{
+    bool retVal = false;
+
+    fileFd = open(filePath, O_RDWR | O_CREAT | flags, 0644);
+    if (fileFd >= 0)
+    {
+        const off_t size = lseek(fileFd, 0, SEEK_END);
+
+        blockOffset = size - (size % LOG_FILE_BLOCK_SIZE);
+        blockUsed = size - blockOffset;
+        retVal = (size >= 0) && ((0 == blockUsed) ||
+                 ((blockOffset == lseek(fileFd, blockOffset, SEEK_SET)) &&
+                  ((ssize_t)blockUsed == read(fileFd, fileBlock, blockUsed))));
+        blockWritten = blockUsed;
+
+        if (!retVal)
+        {
+            fileClose();
+        }
+        else if (blockOffset >= LOG_FILE_MAX_SIZE)
+        {
+            retVal = fileRotate();
+        }
+    }
+
+    return retVal;
+}
+
+// Past a full block, into a new file once this one is full
+static bool nextBlock(void)
+{
+    blockOffset += LOG_FILE_BLOCK_SIZE;
+    blockUsed = 0;
+    blockWritten = 0;
+
+    return (blockOffset < LOG_FILE_MAX_SIZE) || fileRotate();
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Nothing while the file can't be opened, LogTask() retries later
+size_t LogSinkFileGetWriteSize()
+{
+    return ((fileFd >= 0) || fileOpen(0)) ? LOG_FILE_BLOCK_SIZE : 0;
+}
+
+// Only full blocks are written here, the rest waits in the block buffer for
+// more data or for LogSinkFileFlush()
+size_t LogSinkFileWrite(const uint8_t * const buffer, const size_t toSend)
+{
+    size_t retVal = 0;
+    bool ok = (fileFd >= 0) || fileOpen(0);
+
+    while (ok && (retVal < toSend))
+    {
+        const size_t count = MIN(toSend - retVal, LOG_FILE_BLOCK_SIZE - blockUsed);
+
+        memcpy(&fileBlock[blockUsed], &buffer[retVal], count);
+        blockUsed += count;
+        retVal += count;
+
+        if (LOG_FILE_BLOCK_SIZE == blockUsed)
+        {
+            ok = blockWrite();
+            // the rest of the block was accepted before, this part was not
+            retVal -= ok ? 0 : count;
+            ok = ok && nextBlock();
+        }
+    }
+
+    return retVal;
+}
+
+void LogSinkFileFlush()
+{
+    if ((fileFd >= 0) && ((blockWritten == blockUsed) || blockWrite()))
+    {
+        fsync(fileFd);
+    }
+}
+
+eStatus LogSinkFileInit()
+{
+    eStatus retVal = eOK;
+
+    if ('\0' == filePath[0])
+    {
+        retVal = eNOTINITIALIZED;
+    }
+    else if ((fileFd < 0) && !fileOpen(0))
+    {
+        retVal = eFAILED;
+    }
+
+    return retVal;
+}
+
+eStatus LogSinkFileSetPath(const char * const path)
+{
+    eStatus retVal = eOK;
+
+    if ((NULL == path) || ('\0' == path[0]) || (strlen(path) >= sizeof(filePath)))
+    {
+        retVal = eINVALIDARG;
+    }
+    else
+    {
+        strcpy(filePath, path);
+    }
+
+    return retVal;
+}
@@ -0,0 +1,84 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_SINK_FILE_H
+#define INC_LOG_SINK_FILE_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <globals.h>
+#include "logger.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+// Data goes to the file in whole blocks of this size, at offsets aligned to it
+#if !defined(LOG_FILE_BLOCK_SIZE)
+#define LOG_FILE_BLOCK_SIZE     4096
+#endif // LOG_FILE_BLOCK_SIZE
+
+// A file is rotated once it reaches this size, a multiple of the block size
+#if !defined(LOG_FILE_MAX_SIZE)
+#define LOG_FILE_MAX_SIZE       (64 * 1024)
+#endif // LOG_FILE_MAX_SIZE
+
+// Files kept, the current one included: path, path.1 ... path.(count - 1)
+#if !defined(LOG_FILE_COUNT)
+#define LOG_FILE_COUNT          4
+#endif // LOG_FILE_COUNT
+
+#if !defined(LOG_FILE_PATH_SIZE)
+#define LOG_FILE_PATH_SIZE      64
+#endif // LOG_FILE_PATH_SIZE
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+// For LogAddSink() and LogRemoveSink()
+extern const LogSink        LogSinkFile;
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+size_t      LogSinkFileGetWriteSize();
+size_t      LogSinkFileWrite(const uint8_t * const buffer, const size_t toSend);
+void        LogSinkFileFlush();
+eStatus     LogSinkFileInit();
+
+// Where the log goes, e.g. "/spiffs/log.txt". Call before LogAddSink()
+eStatus     LogSinkFileSetPath(const char * const path);
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_SINK_FILE_H
@@ -0,0 +1,272 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// Network sink on the BSD sockets API - lwIP on target, the host's own stack
+// in host builds, so it can be tried out over loopback. A packet per line
+// would cost far more than the line itself, so the log is gathered in a send
+// queue and goes out as datagrams of up to LOG_NET_DATAGRAM_SIZE bytes, or as
+// a TCP stream. Sockets are non-blocking, LogTask() never waits on the network
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#include "log_sink_net.h"
+#include "logger_port.h"
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#if (LOG_NET_QUEUE_SIZE < LOG_NET_DATAGRAM_SIZE)
+#error "LOG_NET_QUEUE_SIZE must hold at least one datagram"
+#endif
+
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL        0
+#endif // MSG_NOSIGNAL
+
+//==============================================================================
+//  Local types
+//==============================================================================
+typedef enum _eNetState
+{
+    eNetIdle,                       // no socket, see retryTime
+    eNetConnecting,                 // TCP connect under way
+    eNetConnected,
+} eNetState;
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static eLogNetProtocol      netProtocol = eLogNetUdp;
+static struct sockaddr_in   netTarget;
+static bool                 netTargetSet = false;
+static int                  netFd = -1;
+static eNetState            netState = eNetIdle;
+static uint32_t             retryTime = 0;      // ms, no reconnecting before
+static uint32_t             backoff = LOG_NET_BACKOFF_MIN;
+
+static uint8_t              queue[LOG_NET_QUEUE_SIZE];
+static size_t               queueStart = 0;
+static size_t               queueUsed = 0;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+const LogSink               LogSinkNet = { "Net", LogSinkNetInit, LogSinkNetGetWriteSize, LogSinkNetWrite, LogSinkNetFlush };
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+
+// Closes the socket and holds off reconnecting for a while, longer every time
+static void netDisconnect(void)
+{
+    if (netFd >= 0)
+    {
+        close(netFd);
+    }
+    netFd = -1;
+    netState = eNetIdle;
+    retryTime = LogPortGetTimeMs() + backoff;
+    backoff = MIN(backoff * 2, (uint32_t)LOG_NET_BACKOFF_MAX);
+}
+
+// Whether a TCP connect under way has completed, without waiting for it
+static void netCheckConnect(void)
+{
+    fd_set writable;
+    struct timeval timeout = { 0, 0 };
+    int error = 0;
+    socklen_t length = sizeof(error);
+
+    FD_ZERO(&writable);
+    FD_SET(netFd, &writable);
+    if (select(netFd + 1, NULL, &writable, NULL, &timeout) > 0)
+    {
+        if ((0 == getsockopt(netFd, SOL_SOCKET, SO_ERROR, &error, &length)) && (0 == error))
+        {
+            netState = eNetConnected;
+            backoff = LOG_NET_BACKOFF_MIN;
+        }
+        else
+        {
+            netDisconnect();
+        }
+    }
+}
+
+// Sets up the socket once the backoff has run out. A UDP socket is connected
+// only to fix its destination, that never waits
+static bool netConnect(void)
+{
+    if ((eNetIdle == netState) && netTargetSet && ((int32_t)(LogPortGetTimeMs() - retryTime) >= 0))
+    {
+        netFd = socket(AF_INET, (eLogNetTcp == netProtocol) ? SOCK_STREAM : SOCK_DGRAM, 0);
+        if ((netFd >= 0) && (0 == fcntl(netFd, F_SETFL, fcntl(netFd, F_GETFL, 0) | O_NONBLOCK)) &&
+            (0 == connect(netFd, (const struct sockaddr *)&netTarget, sizeof(netTarget))))
+        {
+            netState = eNetConnected;
+            backoff = LOG_NET_BACKOFF_MIN;
+        }
+        else if ((netFd >= 0) && (EINPROGRESS == errno))
+        {
+            netState = eNetConnecting;
+        }
+        else
+        {
+            netDisconnect();
+        }
+    }
+
+    if (eNetConnecting == netState)
+    {
+        netCheckConnect();
+    }
+
+    return (eNetConnected == netState);
+}
+
+// Up to a datagram, cut after the last whole line that fits if there is one
+static size_t datagramSize(void)
+{
+    const size_t size = MIN(queueUsed, (size_t)LOG_NET_DATAGRAM_SIZE);
+    size_t retVal = size;
+
+    while ((queueUsed >= LOG_NET_DATAGRAM_SIZE) && (retVal > 0) && ('\n' != queue[queueStart + retVal - 1]))
+    {
+        retVal--;
+    }
+
+    return (0 != retVal) ? retVal : size;
+}
+
+// Sends what the socket takes right now. UDP sends only full datagrams unless
+// all is set, TCP everything queued
+static void netSend(const bool all)
+{
+    bool ok = netConnect();
+
+    while (ok && (queueUsed > 0) && ((eLogNetTcp == netProtocol) || all || (queueUsed >= LOG_NET_DATAGRAM_SIZE)))
+    {
+        const size_t size = (eLogNetTcp == netProtocol) ? queueUsed : datagramSize();
+        const ssize_t sent = send(netFd, &queue[queueStart], size, MSG_NOSIGNAL);
+
+        if (sent > 0)
+        {
+            queueStart += sent;
+            queueUsed -= sent;
+        }
+        else if ((EAGAIN == errno) || (EWOULDBLOCK == errno) || (ENOBUFS == errno) || (ENOMEM == errno))
+        {
+            // out of buffers, the rest waits for the next call
+            ok = false;
+        }
+        else if (eLogNetUdp == netProtocol)
+        {
+            // e.g. nobody listening - the datagram is lost, as it would be on the way
+            queueStart += size;
+            queueUsed -= size;
+        }
+        else
+        {
+            netDisconnect();
+            ok = false;
+        }
+    }
+
+    queueStart = (0 == queueUsed) ? 0 : queueStart;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+// Room in the queue, after sending what can be sent
+size_t LogSinkNetGetWriteSize()
+{
+    netSend(false);
+    return LOG_NET_QUEUE_SIZE - queueUsed;
+}
+
+size_t LogSinkNetWrite(const uint8_t * const buffer, const size_t toSend)
+{
+    const size_t retVal = MIN(toSend, LOG_NET_QUEUE_SIZE - queueUsed);
+
+    if ((queueStart + queueUsed + retVal) > LOG_NET_QUEUE_SIZE)
+    {
+        memmove(queue, &queue[queueStart], queueUsed);
+        queueStart = 0;
+    }
+    memcpy(&queue[queueStart + queueUsed], buffer, retVal);
+    queueUsed += retVal;
+    netSend(false);
+
+    return retVal;
+}
+
+// Sends the last partial datagram too
+void LogSinkNetFlush()
+{
+    netSend(true);
+}
+
+// Doesn't connect yet, that happens on the first write and is retried on
+// failure - the network need not be up when the sink is added
+eStatus LogSinkNetInit()
+{
+    return netTargetSet ? eOK : eNOTINITIALIZED;
+}
+
+eStatus LogSinkNetSetTarget(const eLogNetProtocol protocol, const char * const address, const uint16_t port)
+{
+    eStatus retVal = eOK;
+    struct sockaddr_in target;
+
+    memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    if (((eLogNetUdp != protocol) && (eLogNetTcp != protocol)) || (NULL == address) ||
+        (1 != inet_pton(AF_INET, address, &target.sin_addr)))
+    {
+        retVal = eINVALIDARG;
+    }
+    else
+    {
+        netProtocol = protocol;
+        netTarget = target;
+        netTargetSet = true;
+    }
+
+    return retVal;
+}
@@ -0,0 +1,91 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_SINK_NET_H
+#define INC_LOG_SINK_NET_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <globals.h>
+#include "logger.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+// Payload per UDP datagram: an Ethernet/Wi-Fi MTU less the IPv4 and UDP headers
+#if !defined(LOG_NET_DATAGRAM_SIZE)
+#define LOG_NET_DATAGRAM_SIZE   1472
+#endif // LOG_NET_DATAGRAM_SIZE
+
+// Bytes held while the network can't take them. Once it's full the sink
+// takes no more and falls behind, see LOG_SINK_MAX_LAG
+#if !defined(LOG_NET_QUEUE_SIZE)
+#define LOG_NET_QUEUE_SIZE      4096
+#endif // LOG_NET_QUEUE_SIZE
+
+// Wait before reconnecting after a failure, in ms - doubled after every
+// failure up to the maximum, back to the minimum once connected
+#if !defined(LOG_NET_BACKOFF_MIN)
+#define LOG_NET_BACKOFF_MIN     500
+#endif // LOG_NET_BACKOFF_MIN
+#if !defined(LOG_NET_BACKOFF_MAX)
+#define LOG_NET_BACKOFF_MAX     30000
+#endif // LOG_NET_BACKOFF_MAX
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+typedef enum _eLogNetProtocol
+{
+    eLogNetUdp,                     // lines packed into datagrams, lost if the network drops them
+    eLogNetTcp,                     // a stream, reconnected whenever it breaks
+} eLogNetProtocol;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+// For LogAddSink() and LogRemoveSink()
+extern const LogSink        LogSinkNet;
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+size_t      LogSinkNetGetWriteSize();
+size_t      LogSinkNetWrite(const uint8_t * const buffer, const size_t toSend);
+void        LogSinkNetFlush();
+eStatus     LogSinkNetInit();
+
+// Where the log goes, an IPv4 address in dotted notation. Call before
+// LogAddSink()
+eStatus     LogSinkNetSetTarget(const eLogNetProtocol protocol, const char * const address, const uint16_t port);
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_SINK_NET_H
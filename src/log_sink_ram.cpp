@@ -0,0 +1,272 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// Crash-surviving log: a byte ring in memory the startup code leaves alone,
+// so whatever was logged up to a panic or a watchdog reset is still there
+// after it. Host builds map a file instead, which outlives the process the
+// same way. Writing to RAM costs next to nothing, unlike flushing a file
+// system on every error
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <stddef.h>
+#include <string.h>
+#if defined(LOG_PORT_POSIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // LOG_PORT_POSIX
+
+#include "log_sink_ram.h"
+#include "logger_port.h"
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#if (0 != (LOG_RAM_SIZE & (LOG_RAM_SIZE - 1)))
+#error "LOG_RAM_SIZE must be a power of two"
+#endif
+
+// Where the ring lives on target, e.g. RTC_NOINIT_ATTR to keep it in deep sleep
+#if !defined(LOG_RAM_ATTR)
+#define LOG_RAM_ATTR            LOG_PORT_NOINIT_ATTR
+#endif // LOG_RAM_ATTR
+
+#define RAM_MAGIC               0x5a4c5247      // "ZLRG"
+
+//==============================================================================
+//  Local types
+//==============================================================================
+// Positions are free running. The header always describes bytes that are
+// in place: room is made before data is copied and Head moves after, each
+// step sealed with a new Sequence and Crc
+typedef struct _LogRamHeader
+{
+    uint32_t                Magic;
+    uint32_t                Sequence;       // of the seal, the newer copy wins
+    uint32_t                Generation;
+    uint32_t                Head;
+    uint32_t                Tail;
+    uint32_t                Crc;            // of the fields above
+} LogRamHeader;
+
+// The header copies are sealed in turns, so a reset halfway through sealing
+// one still leaves the other, one step behind
+typedef struct _LogRamStore
+{
+    LogRamHeader            Header[2];
+    uint8_t                 Data[LOG_RAM_SIZE];
+} LogRamStore;
+
+//==============================================================================
+//  Local data
+//==============================================================================
+#if !defined(LOG_PORT_POSIX)
+static LogRamStore          ramStore LOG_RAM_ATTR;
+#endif // !LOG_PORT_POSIX
+static LogRamStore *        ram = NULL;
+static LogRamHeader         header;             // the one sealed last
+static uint32_t             previousTail = 0;   // the log from before the reset
+static uint32_t             previousHead = 0;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+const LogSink               LogSinkRam = { "Ram", LogSinkRamInit, LogSinkRamGetWriteSize, LogSinkRamWrite, NULL };
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+
+// CRC-32 (IEEE), bitwise - it only ever covers the 20 header bytes
+static uint32_t headerCrc(const LogRamHeader * const copy)
+{
+    const uint8_t * const bytes = (const uint8_t *)copy;
+    uint32_t retVal = 0xffffffff;
+
+    for (size_t i = 0; i < offsetof(LogRamHeader, Crc); i++)
+    {
+        retVal ^= bytes[i];
+        for (size_t bit = 0; bit < 8; bit++)
+        {
+            retVal = (retVal >> 1) ^ (0xedb88320 & (0 - (retVal & 1)));
+        }
+    }
+
+    return ~retVal;
+}
+
+// Writes header over the older copy
+static void headerSeal(void)
+{
+    header.Sequence++;
+    header.Crc = headerCrc(&header);
+
+    // the data the header is about is in place before it says so
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    memcpy(&ram->Header[header.Sequence & 1], &header, sizeof(header));
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+static bool headerValid(const LogRamHeader * const copy)
+{
+    return ((RAM_MAGIC == copy->Magic) && (headerCrc(copy) == copy->Crc) &&
+            ((copy->Head - copy->Tail) <= LOG_RAM_SIZE));
+}
+
+#if defined(LOG_PORT_POSIX)
+static LogRamStore * ramMap(void)
+{
+    LogRamStore * retVal = NULL;
+    const int fd = open(LOG_RAM_HOST_FILE, O_RDWR | O_CREAT, 0644);
+
+    if ((fd >= 0) && (0 == ftruncate(fd, sizeof(LogRamStore))))
+    {
+        void * const mapped = mmap(NULL, sizeof(LogRamStore), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        retVal = (MAP_FAILED != mapped) ? (LogRamStore *)mapped : NULL;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+
+    return retVal;
+}
+#else
+static LogRamStore * ramMap(void)
+{
+    return &ramStore;
+}
+#endif // LOG_PORT_POSIX
+
+// Checks what is found in the ring the first time it's needed. A ring that
+// came through intact is kept and continued from the newer valid header copy,
+// the other one if a reset cut sealing it short. Only garbage in both - after
+// a power cycle - starts over empty
+static bool ramAttach(void)
+{
+    if (NULL == ram)
+    {
+        ram = ramMap();
+        if (NULL != ram)
+        {
+            const bool valid0 = headerValid(&ram->Header[0]);
+            const bool valid1 = headerValid(&ram->Header[1]);
+
+            if (valid0 || valid1)
+            {
+                // wrap-safe comparison
+                const int32_t age = (int32_t)(ram->Header[1].Sequence - ram->Header[0].Sequence);
+                memcpy(&header, &ram->Header[(valid1 && (!valid0 || (age > 0))) ? 1 : 0], sizeof(header));
+                header.Generation++;
+                previousTail = header.Tail;
+                previousHead = header.Head;
+            }
+            else
+            {
+                memset(&header, 0, sizeof(header));
+                header.Magic = RAM_MAGIC;
+            }
+            headerSeal();
+        }
+    }
+
+    return (NULL != ram);
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+size_t LogSinkRamGetWriteSize()
+{
+    return LOG_RAM_SIZE;
+}
+
+// Evicts the oldest bytes as needed, of a write larger than the ring only the
+// end is kept
+size_t LogSinkRamWrite(const uint8_t * const buffer, const size_t toSend)
+{
+    size_t retVal = 0;
+
+    if (ramAttach())
+    {
+        const size_t count = MIN(toSend, (size_t)LOG_RAM_SIZE);
+        const uint8_t * const data = &buffer[toSend - count];
+        const size_t offset = header.Head & (LOG_RAM_SIZE - 1);
+        const size_t first = MIN(count, LOG_RAM_SIZE - offset);
+
+        if ((header.Head + count - header.Tail) > LOG_RAM_SIZE)
+        {
+            header.Tail = header.Head + count - LOG_RAM_SIZE;
+            headerSeal();
+        }
+        memcpy(&ram->Data[offset], data, first);
+        memcpy(ram->Data, &data[first], count - first);
+        header.Head += count;
+        headerSeal();
+
+        retVal = toSend;
+    }
+
+    return retVal;
+}
+
+eStatus LogSinkRamInit()
+{
+    return ramAttach() ? eOK : eFAILED;
+}
+
+size_t LogSinkRamExport(const LogSinkWriteFn write)
+{
+    size_t retVal = 0;
+    bool ok = ramAttach() && (NULL != write);
+    uint32_t position = previousTail;
+
+    // whatever new messages have evicted is gone
+    if (ok && ((int32_t)(header.Tail - position) > 0))
+    {
+        position = header.Tail;
+    }
+
+    while (ok && ((int32_t)(previousHead - position) > 0))
+    {
+        const size_t offset = position & (LOG_RAM_SIZE - 1);
+        const size_t count = MIN((size_t)(previousHead - position), LOG_RAM_SIZE - offset);
+        const size_t written = write(&ram->Data[offset], count);
+
+        retVal += written;
+        position += count;
+        ok = (written == count);
+    }
+
+    return retVal;
+}
+
+uint32_t LogSinkRamGetGeneration()
+{
+    return ramAttach() ? header.Generation : 0;
+}
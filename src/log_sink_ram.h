@@ -0,0 +1,78 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_SINK_RAM_H
+#define INC_LOG_SINK_RAM_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <globals.h>
+#include "logger.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+// Bytes of log kept across resets, must be a power of two
+#if !defined(LOG_RAM_SIZE)
+#define LOG_RAM_SIZE            4096
+#endif // LOG_RAM_SIZE
+
+// The file the ring is mapped from in host builds
+#if !defined(LOG_RAM_HOST_FILE)
+#define LOG_RAM_HOST_FILE       "zlogger.ram"
+#endif // LOG_RAM_HOST_FILE
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+// For LogAddSink() and LogRemoveSink()
+extern const LogSink        LogSinkRam;
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+size_t      LogSinkRamGetWriteSize();
+size_t      LogSinkRamWrite(const uint8_t * const buffer, const size_t toSend);
+eStatus     LogSinkRamInit();
+
+// Hands what the ring held from before the reset to write, e.g.
+// LogSinkFileWrite, in up to two parts. Call before LogAddSink(), new
+// messages take the place of the old ones. Returns the bytes written
+size_t      LogSinkRamExport(const LogSinkWriteFn write);
+// Resets the ring has come through intact, 0 if it was set up this run
+uint32_t    LogSinkRamGetGeneration();
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_SINK_RAM_H
@@ -22,6 +22,9 @@
    SOFTWARE.
   ============================================================================*/
 
+// Arduino Serial sink - host builds use log_sink_stdio instead
+#if !defined(LOG_PORT_POSIX)
+
 //==============================================================================
 //  Includes
 //==============================================================================
@@ -44,6 +47,11 @@
 //  Local data
 //==============================================================================
 
+//==============================================================================
+//  Exported data
+//==============================================================================
+const LogSink               LogSinkSerial = { "Serial", LogSinkSerialInit, LogSinkSerialGetWriteSize, LogSinkSerialWrite, NULL };
+
 //==============================================================================
 //  Local functions
 //==============================================================================
@@ -53,10 +61,10 @@
 //  Exported functions
 //==============================================================================
 
+// Room in the TX buffer, so that writes never block on the UART
 size_t LogSinkSerialGetWriteSize()
 {
-
-    return 256; // TODO: arbitrary
+    return (size_t)Serial.availableForWrite();
 }
 
 size_t LogSinkSerialWrite(const uint8_t * const buffer, const size_t toSend)
@@ -70,3 +78,5 @@ eStatus LogSinkSerialInit()
     Serial.begin(115200);
     return eOK;
 }
+
+#endif // !LOG_PORT_POSIX
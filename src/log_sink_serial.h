@@ -35,6 +35,7 @@ extern "C"
 #endif // __cplusplus
 
 #include <globals.h>
+#include "logger.h"
 
 //==============================================================================
 //  Defines
@@ -47,6 +48,8 @@ extern "C"
 //==============================================================================
 //  Exported data
 //==============================================================================
+// For LogAddSink() and LogRemoveSink()
+extern const LogSink        LogSinkSerial;
 
 //==============================================================================
 //  Exported functions
@@ -0,0 +1,88 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// stdio sink for host builds, the counterpart of log_sink_serial
+#if defined(LOG_PORT_POSIX)
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <stdio.h>
+
+#include "log_sink_stdio.h"
+#include <globals.h>
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define STDIO_WRITE_SIZE    4096
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+static FILE *               sinkStream = NULL;
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+const LogSink               LogSinkStdio = { "Stdio", LogSinkStdioInit, LogSinkStdioGetWriteSize, LogSinkStdioWrite, NULL };
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+size_t LogSinkStdioGetWriteSize()
+{
+    return STDIO_WRITE_SIZE;
+}
+
+size_t LogSinkStdioWrite(const uint8_t * const buffer, const size_t toSend)
+{
+    return fwrite(buffer, 1, toSend, sinkStream);
+}
+
+eStatus LogSinkStdioInit()
+{
+    if (NULL == sinkStream)
+    {
+        sinkStream = stdout;
+    }
+    return eOK;
+}
+
+void LogSinkStdioSetStream(FILE * const stream)
+{
+    sinkStream = stream;
+}
+
+#endif // LOG_PORT_POSIX
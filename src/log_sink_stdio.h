@@ -0,0 +1,66 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+//==============================================================================
+//  Multi-include guard
+//==============================================================================
+#ifndef INC_LOG_SINK_STDIO_H
+#define INC_LOG_SINK_STDIO_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif // __cplusplus
+
+#include <stdio.h>
+#include <globals.h>
+#include "logger.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+
+//==============================================================================
+//  Exported types
+//==============================================================================
+
+//==============================================================================
+//  Exported data
+//==============================================================================
+// For LogAddSink() and LogRemoveSink()
+extern const LogSink        LogSinkStdio;
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+size_t      LogSinkStdioGetWriteSize();
+size_t      LogSinkStdioWrite(const uint8_t * const buffer, const size_t toSend);
+eStatus     LogSinkStdioInit();
+
+// Redirects the sink, stdout by default. Call before LogInit()
+void        LogSinkStdioSetStream(FILE * const stream);
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+#endif // INC_LOG_SINK_STDIO_H
@@ -27,20 +27,125 @@
 //==============================================================================
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include "logger.h"
 #include "logger_port.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/stream_buffer.h"
+#include "log_ring.h"
+#if defined(LOG_PORT_POSIX)
+#include "log_sink_stdio.h"
+#else
 #include "log_sink_serial.h"
+#endif // LOG_PORT_POSIX
+#include "log_compress.h"
+#include "log_deferred.h"
+#include "log_format.h"
 
 //==============================================================================
 //  Defines
 //==============================================================================
 #define CMP_NAME            "Logger"
-#define LOG_MAX_WAIT        (uint32_t)100   // max time to wait for synchronization
-#define LOG_BUFFER_SIZE     4096
+#define LOG_BUFFER_SIZE     4096            // must be a power of two
 #define LOG_MAX_LINE_SIZE   (224)
+#define LOG_TRAILER_MAX_SIZE    (8)         // color reset and CRLF
+
+// Largest single record, multi-line ones included - see LogDumpBuffer(). Also
+// the hard cap on a single message: Log() formats straight into the ring,
+// starting with LOG_MAX_LINE_SIZE and growing the record as needed. Must hold a
+// header line plus a dump line, and fit a ring three times, see below
+#if !defined(LOG_MAX_RECORD_SIZE)
+#define LOG_MAX_RECORD_SIZE 512
+#endif // LOG_MAX_RECORD_SIZE
+#if (LOG_MAX_RECORD_SIZE < (2 * LOG_MAX_LINE_SIZE))
+#error "LOG_MAX_RECORD_SIZE must be at least twice LOG_MAX_LINE_SIZE"
+#endif
+
+// The log buffer is split into this many rings and each core writes to its
+// own, so producers on different cores never touch the same cache lines.
+// LogTask() merges them back in timestamp order. LOG_BUFFER_SIZE divided by
+// the count must still be a power of two
+#if !defined(LOG_BUFFER_COUNT)
+#define LOG_BUFFER_COUNT    LOG_PORT_CORE_COUNT
+#endif // LOG_BUFFER_COUNT
+#define LOG_RING_SIZE       (LOG_BUFFER_SIZE / LOG_BUFFER_COUNT)
+#if ((LOG_BUFFER_SIZE % LOG_BUFFER_COUNT) != 0) || ((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) != 0)
+#error "LOG_BUFFER_SIZE / LOG_BUFFER_COUNT must be a power of two"
+#endif
+
+// Batched draining: LogTask() collects up to LOG_BATCH_SIZE bytes, or whatever
+// arrived within LOG_BATCH_MAX_LATENCY ms of the first message, and writes them
+// to each sink in one go. Costs one extra copy per message, saves a lot of
+// small sink writes and LogTask() wakeups. 0 disables batching
+#if !defined(LOG_BATCH_SIZE)
+#define LOG_BATCH_SIZE      0
+#endif // LOG_BATCH_SIZE
+#if !defined(LOG_BATCH_MAX_LATENCY)
+#define LOG_BATCH_MAX_LATENCY   (uint32_t)50
+#endif // LOG_BATCH_MAX_LATENCY
+#if (LOG_BATCH_SIZE > 0) && (LOG_BATCH_SIZE < LOG_MAX_LINE_SIZE)
+#error "LOG_BATCH_SIZE must hold at least one LOG_MAX_LINE_SIZE line"
+#endif
+
+// Compressed sinks, see eLogSinkFormatCompress: every batch goes out as one
+// log_compress frame. Costs a frame buffer the size of a batch. A batch that
+// doesn't compress grows, its frame payload must still fit 16 bits
+#if !defined(LOG_COMPRESS)
+#define LOG_COMPRESS        0
+#endif // LOG_COMPRESS
+#if (LOG_COMPRESS > 0) && ((LOG_BATCH_SIZE == 0) || \
+        ((LOG_COMPRESS_BOUND(LOG_BATCH_SIZE) - LOG_COMPRESS_HEADER_SIZE) > LOG_COMPRESS_MAX_PAYLOAD))
+#error "LOG_COMPRESS needs LOG_BATCH_SIZE, small enough for LOG_COMPRESS_MAX_PAYLOAD once compressed"
+#endif
+
+// Dedicated ring for LogFromISR(), must be a power of two. It comes after the
+// per-core ones wherever the rings are indexed
+#if !defined(LOG_ISR_BUFFER_SIZE)
+#define LOG_ISR_BUFFER_SIZE 512
+#endif // LOG_ISR_BUFFER_SIZE
+#if (LOG_ISR_BUFFER_SIZE == 0) || ((LOG_ISR_BUFFER_SIZE & (LOG_ISR_BUFFER_SIZE - 1)) != 0)
+#error "LOG_ISR_BUFFER_SIZE must be a power of two"
+#endif
+#define LOG_RING_COUNT      (LOG_BUFFER_COUNT + 1)
+
+// Every sink reads the rings at its own pace. One that falls more than this
+// percentage of a ring behind the sink furthest ahead skips its oldest
+// messages, so that a slow sink can't fill the buffer and hold up the others
+#if !defined(LOG_SINK_MAX_LAG)
+#define LOG_SINK_MAX_LAG    50
+#endif // LOG_SINK_MAX_LAG
+// How often LogTask() retries sinks that had no room for more, in ms
+#if !defined(LOG_SINK_RETRY_INTERVAL)
+#define LOG_SINK_RETRY_INTERVAL 10
+#endif // LOG_SINK_RETRY_INTERVAL
+// Sinks that buffer are flushed right after a message of this level or above,
+// and at the latest this many ms after the first write since the last flush
+#if !defined(LOG_SINK_FLUSH_LEVEL)
+#define LOG_SINK_FLUSH_LEVEL    eLogError
+#endif // LOG_SINK_FLUSH_LEVEL
+#if !defined(LOG_SINK_FLUSH_INTERVAL)
+#define LOG_SINK_FLUSH_INTERVAL (uint32_t)1000
+#endif // LOG_SINK_FLUSH_INTERVAL
+
+// Registered by LogInit(), LogRemoveSink() it if it's not wanted
+#if defined(LOG_PORT_POSIX)
+#define LOG_SINK_DEFAULT    LogSinkStdio
+#else
+#define LOG_SINK_DEFAULT    LogSinkSerial
+#endif // LOG_PORT_POSIX
+
+// Buffer dumps: bytes per line and whether to add an ASCII column
+#define DUMP_BYTES_PER_LINE 16
+#if !defined(LOG_DUMP_ASCII)
+#define LOG_DUMP_ASCII      1
+#endif // LOG_DUMP_ASCII
+// A dump larger than a ring goes in parts, each waiting up to this many ms for
+// LogTask() to make room for it before the overflow policy applies. A batch
+// may hold LogTask() back for LOG_BATCH_MAX_LATENCY first
+#if !defined(LOG_DUMP_PART_WAIT) && (LOG_BATCH_SIZE > 0)
+#define LOG_DUMP_PART_WAIT  (LOG_BATCH_MAX_LATENCY + 100)
+#elif !defined(LOG_DUMP_PART_WAIT)
+#define LOG_DUMP_PART_WAIT  100
+#endif // LOG_DUMP_PART_WAIT
 
 #define COLOR_NONE          "\033[0m"       // default FG color
 #define COLOR_TRACE         "\033[34m"      // Blue
@@ -54,29 +159,168 @@
 
 #define LOG_USE_COLOR 1
 
+// What sinks are rendered with until LogSetSinkFormat() says otherwise
+#if defined(LOG_USE_COLOR)
+#define LOG_SINK_FORMAT_DEFAULT     eLogSinkFormatAll
+#else
+#define LOG_SINK_FORMAT_DEFAULT     (eLogSinkFormatAll & ~eLogSinkFormatColor)
+#endif // LOG_USE_COLOR
+
+// Longest LogPortTimeGetString() result kept with a message, the rest is cut
+#if !defined(LOG_TIME_STRING_MAX)
+#define LOG_TIME_STRING_MAX 32
+#endif // LOG_TIME_STRING_MAX
+#if (LOG_TIME_STRING_MAX > 255)
+#error "LOG_TIME_STRING_MAX must fit a byte"
+#endif
+
+// A full size record in a ring: one grown at the end of the buffer moves to its
+// start, leaving the padding and its old place behind. 80 bytes more cover the
+// ring, timestamp and dump headers, which LogDumpBuffer() relies on
+#if (LOG_RING_SIZE < ((3 * LOG_MAX_RECORD_SIZE) + 80 + LOG_TIME_STRING_MAX))
+#error "LOG_BUFFER_SIZE / LOG_BUFFER_COUNT must hold three LOG_MAX_RECORD_SIZE records"
+#endif
+
+// Deferred formatting: Log() only packs the format string pointer and the raw
+// arguments, LogTask() renders the text. Format strings, component and function
+// names must outlive the message, which string literals do
+#if !defined(LOG_DEFERRED_FORMAT)
+#define LOG_DEFERRED_FORMAT 0
+#endif // LOG_DEFERRED_FORMAT
+
 //==============================================================================
 //  Local types
 //==============================================================================
+// Every record header starts with the level, so that sinks can be filtered
+// without looking any further. Right after the header comes the human-readable
+// time the message was logged at, TimeLength chars of it, then the rest
+typedef enum _eLogRecordType
+{
+    eLogRecordText,         // LogTextHeader followed by the message text
+    eLogRecordDeferred,     // LogDeferredHeader followed by packed arguments
+    eLogRecordDump,         // LogDumpHeader followed by raw bytes
+} eLogRecordType;
+
+// A message formatted by Log(). The header line, colors and line end depend on
+// the sink, LogTask() adds them. As with deferred records, the strings must
+// outlive the message
+typedef struct _LogTextHeader
+{
+    uint8_t                 Level;
+    uint8_t                 TimeLength; // of LogPortTimeGetString() when logged
+    uint32_t                Time;       // ms, as returned by LogPortGetTimeMs()
+    const char *            Component;
+    const char *            Function;
+} LogTextHeader;
+
+// What growRecord() needs to know about the record logImmediate() formats into
+typedef struct _LogGrowContext
+{
+    LogRing *               Ring;
+    size_t                  Prefix;     // header and time string ahead of the text
+    bool                    Failed;     // no room to grow, the message is dropped
+} LogGrowContext;
+
+// A piece of a record as written to a sink
+typedef struct _LogSpan
+{
+    const uint8_t *         Data;
+    size_t                  Size;
+} LogSpan;
 
+// A buffer dump, or the part of it starting at Offset if it didn't fit a
+// single record. One that doesn't fit a ring either is logged in Parts parts,
+// each of them whole or not at all
+typedef struct _LogDumpHeader
+{
+    uint8_t                 Level;
+    uint8_t                 TimeLength; // of LogPortTimeGetString() when logged
+    uint16_t                Part;       // 1 to Parts
+    uint32_t                Time;       // ms, as returned by LogPortGetTimeMs()
+    const char *            Component;
+    const char *            Function;
+    uint32_t                Total;      // size of the whole dump
+    uint32_t                Offset;
+    uint16_t                Parts;
+} LogDumpHeader;
+
+// Where a sink is in each ring. A record is written to a sink as far as it has
+// room for, the rest of it goes out before anything else on the next round
+typedef struct _LogSinkCursor
+{
+    uint32_t                Position[LOG_RING_COUNT];
+    size_t                  Ring;           // of the record at hand
+    volatile size_t         Written;        // bytes of it written so far
+    uint32_t                Format;         // it is rendered with
+    volatile bool           Busy;           // being written, eLogOverflowOverwriteOldest only
+    volatile bool           Evicted;        // while it was busy with it
+    volatile bool           Cut;            // evicted partway through, the line wants ending
+    volatile uint32_t       Dropped;        // since the last dropped marker
+} LogSinkCursor;
+
+// Registry slots change state atomically, so that sinks come and go without
+// LogTask() taking a lock. It picks up the changes at the start of a round
+typedef enum _eLogSinkState
+{
+    eLogSinkFree,
+    eLogSinkClaimed,        // being filled in by LogAddSink()
+    eLogSinkAdded,          // waiting for LogTask() to pick it up
+    eLogSinkActive,
+    eLogSinkRemoved,        // waiting for LogTask() to let go of it
+} eLogSinkState;
+
+typedef struct _LogSinkSlot
+{
+    const LogSink *         Sink;
+    volatile eLogSinkState  State;
+    size_t                  Budget;         // what's left of the last GetWriteSize()
+    size_t                  ChunkSize;      // the last non-zero GetWriteSize()
+    volatile eLogLevel      Level;          // on top of LogCurrentLevel
+    volatile uint32_t       Format;         // eLogSinkFormat flags
+    bool                    Dirty;          // written to since the last Flush()
+    uint32_t                DirtyTime;      // ms, of the first write since
+} LogSinkSlot;
 
 //==============================================================================
 //  Local data
 //==============================================================================
-static eLogLevel            currentLevel = eLogInfo;
-#if (configSUPPORT_STATIC_ALLOCATION == 1)
-static uint8_t              logBufferStorage[LOG_BUFFER_SIZE] = { 0 };
-static StaticStreamBuffer_t logBufferStruct;
-#endif // configSUPPORT_STATIC_ALLOCATION
-static uint8_t              tmpWriteBuf[LOG_MAX_LINE_SIZE] = { 0 };
+static uint8_t              logBufferStorage[LOG_BUFFER_COUNT][LOG_RING_SIZE] __attribute__((aligned(LOG_RING_ALIGN)));
+#if (LOG_BATCH_SIZE > 0)
+static uint8_t              batchBuf[LOG_BATCH_SIZE] = { 0 };
+#if (LOG_COMPRESS > 0)
+static uint8_t              compressBuf[LOG_COMPRESS_BOUND(LOG_BATCH_SIZE)];
+#endif // LOG_COMPRESS
+static size_t               batchUsed = 0;
+#endif // LOG_BATCH_SIZE
 static uint8_t              tmpReadBuf[LOG_MAX_LINE_SIZE] = { 0 };
 static bool                 initialized = false;
+static volatile bool        consumerWaiting = false;
+// LogTask()'s task - what it logs itself must never wait for it to make room
+static volatile uintptr_t   consumerTask = 0;
+static bool                 sinksStalled = false;  // a sink had no room for its messages last round
+
+static eLogOverflowPolicy   overflowPolicy = eLogOverflowDropNewest;
+static size_t               blockTimeout = 0;
+static volatile uint32_t    droppedCount = 0;      // by all sinks, since LogTask() last looked
+static LogStats             logStats;
+// eLogOverflowOverwriteOldest only: records are copied out of the ring, so
+// producers may evict any committed record at any time, even one a sink is
+// busy writing out. Records are a timestamp followed by at most
+// LOG_MAX_RECORD_SIZE bytes
+static uint8_t              recordCopy[sizeof(uint32_t) + LOG_MAX_RECORD_SIZE] __attribute__((aligned(LOG_RING_ALIGN)));
 
-static StreamBufferHandle_t logBuffer = NULL;
+static LogRing              logRings[LOG_BUFFER_COUNT];
+static uint8_t              logIsrBufferStorage[LOG_ISR_BUFFER_SIZE] __attribute__((aligned(LOG_RING_ALIGN)));
+static LogRing              logIsrRing;
+// Space given back is claimed under the cursors lock, up to claimEnd, and
+// zeroed outside of it. Tail follows once no one is zeroing any more
+static uint32_t             claimEnd[LOG_RING_COUNT];
+static uint32_t             claimers[LOG_RING_COUNT];
 
-// Log sinks
-static const LogSink sinks[] = {
-    { "Serial", LogSinkSerialInit, LogSinkSerialGetWriteSize, LogSinkSerialWrite },
-};
+// Log sinks, see LogAddSink(). The cursor of a slot is in use from the time
+// LogTask() picks it up until it lets go of it
+static LogSinkSlot          sinkSlots[LOG_MAX_SINKS];
+static LogSinkCursor        sinkCursors[LOG_MAX_SINKS];
 
 #if defined(LOG_USE_COLOR)
 static const char * colorEscapeSequences[] = {
@@ -90,40 +334,284 @@ static const char * colorEscapeSequences[] = {
     COLOR_DISABLED};
 #endif // LOG_USE_COLOR
 
+//==============================================================================
+//  Exported data
+//==============================================================================
+volatile eLogLevel          LogCurrentLevel = eLogInfo;
+volatile uint32_t           LogFilteredCount = 0;
+
 //==============================================================================
 //  Local functions
 //==============================================================================
 
-static size_t getSinksSmallestWriteSize()
+static LogRing * ringAt(const size_t index)
+{
+    return (index < LOG_BUFFER_COUNT) ? &logRings[index] : &logIsrRing;
+}
+
+static LOG_PORT_ISR_ATTR void statsAdd(volatile uint32_t * const counter, const uint32_t value)
+{
+    __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+// Producers evicting messages move sink cursors too, so with
+// eLogOverflowOverwriteOldest they are only touched under the port lock
+static void cursorsLock(void)
+{
+    if (eLogOverflowOverwriteOldest == overflowPolicy)
+    {
+        LogPortLock();
+    }
+}
+
+static void cursorsUnlock(void)
+{
+    if (eLogOverflowOverwriteOldest == overflowPolicy)
+    {
+        LogPortUnlock();
+    }
+}
+
+// Whether sink i has a cursor in use. Only LogTask() changes that, under the
+// cursors lock
+static bool sinkLive(const size_t sink)
+{
+    const eLogSinkState state = __atomic_load_n(&sinkSlots[sink].State, __ATOMIC_ACQUIRE);
+    return ((eLogSinkActive == state) || (eLogSinkRemoved == state));
+}
+
+// Claims ring r up to position, which no sink may be behind, for zeroing.
+// Cursors lock held. Returns where the claim starts
+static uint32_t claimSpace(const size_t r, const uint32_t position)
+{
+    const uint32_t retVal = claimEnd[r];
+
+    claimEnd[r] = position;
+    claimers[r]++;
+
+    return retVal;
+}
+
+// Zeroes a claim outside the cursors lock. The last one done hands all that
+// was claimed back to the producers
+static void releaseSpace(const size_t r, const uint32_t from, const uint32_t to)
+{
+    LogRing * const ring = ringAt(r);
+
+    LogRingClear(ring, from, to);
+
+    cursorsLock();
+    if (0 == --claimers[r])
+    {
+        LogRingRelease(ring, claimEnd[r]);
+    }
+    cursorsUnlock();
+}
+
+// The sink goes first, so that addSink() doesn't take the slot for one
+// that's still in it
+static void freeSlot(const size_t slot)
+{
+    __atomic_store_n(&sinkSlots[slot].Sink, (const LogSink *)NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&sinkSlots[slot].State, eLogSinkFree, __ATOMIC_RELEASE);
+}
+
+// Takes on the sinks added and lets go of the ones removed since the last
+// round. A new sink starts with whatever is still in the buffer
+static void updateSinks(void)
+{
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+    {
+        LogSinkSlot * const slot = &sinkSlots[i];
+        const eLogSinkState state = __atomic_load_n(&slot->State, __ATOMIC_ACQUIRE);
+
+        // whatever it holds back goes out before it is let go
+        if ((eLogSinkRemoved == state) && slot->Dirty)
+        {
+            slot->Sink->Flush();
+            slot->Dirty = false;
+        }
+
+        cursorsLock();
+        if (eLogSinkAdded == state)
+        {
+            LogSinkCursor * const cursor = &sinkCursors[i];
+            for (size_t r = 0; r < LOG_RING_COUNT; r++)
+            {
+                cursor->Position[r] = claimEnd[r];
+            }
+            cursor->Ring = 0;
+            cursor->Written = 0;
+            cursor->Busy = false;
+            cursor->Evicted = false;
+            cursor->Cut = false;
+            cursor->Dropped = 0;
+            slot->Budget = 0;
+            slot->ChunkSize = 1;
+            slot->Dirty = false;
+
+            // unless it was removed meanwhile
+            eLogSinkState expected = eLogSinkAdded;
+            if (!__atomic_compare_exchange_n(&slot->State, &expected, eLogSinkActive, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            {
+                freeSlot(i);
+            }
+        }
+        else if (eLogSinkRemoved == state)
+        {
+            freeSlot(i);
+        }
+        cursorsUnlock();
+    }
+}
+
+static void sinkFlush(const size_t sink);
+
+// Cached, the sink is asked again only once the answer is used up, and what
+// was batched against it has gone out
+static size_t sinkGetBudget(const size_t sink)
+{
+    LogSinkSlot * const slot = &sinkSlots[sink];
+
+    if (0 == slot->Budget)
+    {
+        sinkFlush(sink);
+        slot->Budget = slot->Sink->GetWriteSize();
+        slot->ChunkSize = (0 != slot->Budget) ? slot->Budget : slot->ChunkSize;
+    }
+
+    return slot->Budget;
+}
+
+static void sinkMarkDirty(const size_t sink)
+{
+    LogSinkSlot * const slot = &sinkSlots[sink];
+
+    if ((NULL != slot->Sink->Flush) && !slot->Dirty)
+    {
+        slot->Dirty = true;
+        slot->DirtyTime = LogPortGetTimeMs();
+    }
+}
+
+static void sinkWriteOut(const size_t sink, const uint8_t * const buffer, const size_t toSend)
+{
+    const LogSink * const target = sinkSlots[sink].Sink;
+    size_t written = target->Write(buffer, toSend);
+
+    sinkMarkDirty(sink);
+    logStats.Sinks[sink].BytesWritten += written;
+    logStats.Sinks[sink].WriteErrors += (written != toSend) ? 1 : 0;
+    if (written != toSend)
+    {
+        Log(eLogWarn, CMP_NAME, "Failure writing to sink %s: tried to write: %d, written: %d",
+                target->Name, toSend, written);
+    }
+}
+
+// In pieces no larger than the sink's write size
+static void sinkWriteChunked(const size_t sink, const uint8_t * const buffer, const size_t size)
+{
+    const size_t chunkSize = sinkSlots[sink].ChunkSize;
+
+    for (size_t written = 0; written < size; written += chunkSize)
+    {
+        sinkWriteOut(sink, &buffer[written], MIN(chunkSize, size - written));
+    }
+}
+
+// A block of rendered text, as one compressed frame for sinks that want it.
+// Sized as it is, compressBuf always takes the frame; should it not, the lines
+// are counted as dropped rather than sent as something log_unpack can't read
+static void sinkWriteBlock(const size_t sink, const uint8_t * const buffer, const size_t size)
 {
-    size_t writeSize = 0xffffffff;
-    for (size_t i = 0; i < ARRAY_SIZE(sinks); i++)
+#if (LOG_COMPRESS > 0)
+    if ((0 != (sinkSlots[sink].Format & eLogSinkFormatCompress)) && (size > 0))
     {
-        size_t tmp = sinks[i].GetWriteSize();
-        if (tmp < writeSize)
+        const size_t frameSize = LogCompress(buffer, size, compressBuf, sizeof(compressBuf));
+        uint32_t lines = 0;
+
+        for (size_t i = 0; (0 == frameSize) && (i < size); i++)
         {
-            writeSize = tmp;
+            lines += ('\n' == buffer[i]) ? 1 : 0;
         }
+        statsAdd(&sinkCursors[sink].Dropped, lines);
+        statsAdd(&logStats.Sinks[sink].MessagesDropped, lines);
+        sinkWriteChunked(sink, compressBuf, frameSize);
+    }
+    else
+#endif // LOG_COMPRESS
+    {
+        sinkWriteChunked(sink, buffer, size);
     }
-    return writeSize;
 }
 
-static size_t sinksWrite(const uint8_t * const buffer, const size_t toSend)
+#if (LOG_BATCH_SIZE > 0)
+static void sinkFlush(const size_t sink)
 {
-    size_t written = toSend;
+    sinkWriteBlock(sink, batchBuf, batchUsed);
+    batchUsed = 0;
+}
 
-    for (size_t i = 0; i < ARRAY_SIZE(sinks); i++)
+// Collected in batchBuf, which goes out when full or at the end of the round
+static void sinkWrite(const size_t sink, const uint8_t * const buffer, const size_t size)
+{
+    for (size_t copied = 0; copied < size; )
     {
-        size_t tmp = sinks[i].Write(buffer, toSend);
-        if (tmp != written)
+        const size_t count = MIN(size - copied, sizeof(batchBuf) - batchUsed);
+
+        memcpy(&batchBuf[batchUsed], &buffer[copied], count);
+        batchUsed += count;
+        copied += count;
+        if (sizeof(batchBuf) == batchUsed)
         {
-            Log(eLogWarn, CMP_NAME, "Failure writing to sink %s: tried to write: %d, written: %d",
-                    sinks[i].Name, toSend, tmp);
+            sinkFlush(sink);
         }
     }
-    return written;
+}
+#else
+static void sinkFlush(const size_t sink)
+{
+    (void)sink;
+}
+
+static void sinkWrite(const size_t sink, const uint8_t * const buffer, const size_t size)
+{
+    sinkWriteChunked(sink, buffer, size);
+}
+#endif // LOG_BATCH_SIZE
+
+// Hands the sink what is batched up, then has it push out what it holds back
+static void sinkSync(const size_t sink)
+{
+    LogSinkSlot * const slot = &sinkSlots[sink];
+
+    sinkFlush(sink);
+    if (slot->Dirty)
+    {
+        slot->Sink->Flush();
+        slot->Dirty = false;
+    }
 }
 
+// Writes count bytes of the spans put together, starting at offset
+static void sinkWriteSpans(const size_t sink, const LogSpan * const spans, const size_t spanCount, size_t offset, size_t count)
+{
+    for (size_t i = 0; (i < spanCount) && (count > 0); i++)
+    {
+        if (offset >= spans[i].Size)
+        {
+            offset -= spans[i].Size;
+        }
+        else
+        {
+            const size_t part = MIN(spans[i].Size - offset, count);
+            sinkWrite(sink, &spans[i].Data[offset], part);
+            count -= part;
+            offset = 0;
+        }
+    }
+}
 
 static char getLevelChar(const eLogLevel level)
 {
@@ -162,205 +650,1714 @@ const char * getDefaultColor(void)
 }
 #endif // LOG_USE_COLOR
 
-//==============================================================================
-//  Exported functions
-//==============================================================================
-eStatus Log(const eLogLevel level, const char * const component, const char * const function, ...)
+// Everything up to the message itself, with all of format:
+// "<color><time string>|<time>|<level>|<component>|<function>:"
+static void formatHeader(LogFormatBuffer * const buffer, const uint32_t format, const eLogLevel level, const uint32_t time,
+        const char * const timeString, const size_t timeLength, const char * const component, const char * const function)
 {
-    eStatus retVal = eOK;
-
-    if (!initialized)
+#if defined(LOG_USE_COLOR)
+    if (0 != (format & eLogSinkFormatColor))
     {
-        retVal = eNOTINITIALIZED;
+        LogFormatString(buffer, getColor(level));
     }
-    else if (LogPortInISR())
+#endif  // LOG_USE_COLOR
+    if (0 != (format & eLogSinkFormatTimeString))
     {
-        // not a good idea to call prinf and friends inside an ISR
-        retVal = eUNSUPPORTED;
+        LogFormatChars(buffer, timeString, timeLength);
+        LogFormatChar(buffer, '|');
     }
-    else if (level >= eLogLevelCount)
+    if (0 != (format & eLogSinkFormatTime))
     {
-        retVal = eINVALIDARG;
+        LogFormatDecimal(buffer, time, LOG_PORT_TIME_DIGITS);
+        LogFormatChar(buffer, '|');
     }
-
-    if (eOK == retVal)
+    if (0 != (format & eLogSinkFormatLevel))
     {
-        if (level >= currentLevel)
-        {
-            int i;
-            int writePtr = 0;
+        LogFormatChar(buffer, getLevelChar(level));
+        LogFormatChar(buffer, '|');
+    }
+    if (0 != (format & eLogSinkFormatComponent))
+    {
+        LogFormatString(buffer, component);
+        LogFormatChar(buffer, '|');
+    }
+    if (0 != (format & eLogSinkFormatFunction))
+    {
+        LogFormatString(buffer, function);
+        LogFormatChar(buffer, ':');
+    }
+}
 
-            if (LogPortLock(LOG_MAX_WAIT))
-            {
-                // first print the time
+// The message body is formatted into a buffer LOG_TRAILER_MAX_SIZE short of
+// the full line, so even a truncated line gets its color reset and newline
+static void formatTrailer(LogFormatBuffer * const buffer, const uint32_t format)
+{
+    buffer->Size += LOG_TRAILER_MAX_SIZE;
 #if defined(LOG_USE_COLOR)
-                i = snprintf((char *)&tmpWriteBuf[writePtr], LOG_MAX_LINE_SIZE,
-                        "%s%s|%s|%c|%s|%s:", getColor(level), LogPortTimeGetString(), LogPortGetTime(), getLevelChar(level), component, function);
+    if (0 != (format & eLogSinkFormatColor))
+    {
+        LogFormatString(buffer, getDefaultColor());
+    }
 #else
-                i = snprintf((char *)&tmpWriteBuf[writePtr], LOG_MAX_LINE_SIZE,
-                        "%s|%s|%c|%s|%s:", LogPortTimeGetString(), LogPortGetTime(), getLevelChar(level), component, function);
+    (void)format;
 #endif  // LOG_USE_COLOR
+    LogFormatChars(buffer, "\r\n", 2);
+}
 
-                if (i < 0)
-                {
-                    retVal = eFAILED;
-                }
-                else
-                {
-                    writePtr += i;
-                    // if that went well, append the actual message as well
-                    va_list args;
-                    va_start(args, function);
-                    const char * fmt = va_arg(args, char *);
-
-                    int i = vsnprintf((char *)&tmpWriteBuf[writePtr], LOG_MAX_LINE_SIZE - writePtr, fmt, args);
-                    va_end(args);
-
-                    if (i < 0)
-                    {
-                        retVal = eFAILED;
-                    }
-                    else
-                    {
-                        writePtr += i;
-                        // add a newline
-#if defined(LOG_USE_COLOR)
-                        i = snprintf((char *)&tmpWriteBuf[writePtr], LOG_MAX_LINE_SIZE - writePtr, "%s\r\n", getDefaultColor());
+static LOG_PORT_ISR_ATTR void statsUpdateHighWater(const LogRing * const ring)
+{
+    const uint32_t fill = __atomic_load_n(&ring->Head, __ATOMIC_RELAXED) - __atomic_load_n(&ring->Tail, __ATOMIC_RELAXED);
+    uint32_t highWater = __atomic_load_n(&logStats.BufferHighWater, __ATOMIC_RELAXED);
+
+    // only ever raced by other producers setting a new maximum, which is rare
+    while ((fill > highWater) && (fill <= ring->Size) &&
+           !__atomic_compare_exchange_n(&logStats.BufferHighWater, &highWater, fill, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+// Length of a dump line of count bytes, CRLF included:
+// "0000  00 01 02 03 04 05 06 07  08 09 0A 0B 0C 0D 0E 0F  |................|"
+static size_t dumpLineLength(const size_t count, const size_t offsetDigits)
+{
+#if (LOG_DUMP_ASCII == 1)
+    // the hex column is padded to full width to keep the ASCII one aligned
+    return offsetDigits + 2 + (DUMP_BYTES_PER_LINE * 3) + 1 + 2 + count + 1 + 2;
 #else
-                        i = snprintf((char *)&tmpWriteBuf[writePtr], LOG_MAX_LINE_SIZE - writePtr, "\r\n");
-#endif  // LOG_USE_COLOR
-                        if (i < 0)
-                        {
-                            retVal = eFAILED;
-                        }
-                        else
-                        {
-                            writePtr += i;
-                        }
-                    }
-                }
+    return offsetDigits + 2 + (count * 3) - 1 + ((count > (DUMP_BYTES_PER_LINE / 2)) ? 1 : 0) + 2;
+#endif // LOG_DUMP_ASCII
+}
 
-                xStreamBufferSend(logBuffer, tmpWriteBuf, writePtr, 1);
+static char * formatDumpLine(char * out, uint32_t offset, const size_t offsetDigits, const uint8_t * const data, const size_t count)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
 
-                LogPortUnlock();
-            }
-            else
-            {
-                retVal = eBUSY;
-            }
+    for (size_t i = offsetDigits; i > 0; i--)
+    {
+        out[i - 1] = hexDigits[offset & 0x0f];
+        offset >>= 4;
+    }
+    out += offsetDigits;
+    *out++ = ' ';
+    *out++ = ' ';
+
+#if (LOG_DUMP_ASCII == 1)
+    for (size_t i = 0; i < DUMP_BYTES_PER_LINE; i++)
+    {
+        out[0] = (i < count) ? hexDigits[data[i] >> 4] : ' ';
+        out[1] = (i < count) ? hexDigits[data[i] & 0x0f] : ' ';
+        out[2] = ' ';
+        out += 3;
+        if (((DUMP_BYTES_PER_LINE / 2) - 1) == i)
+        {
+            *out++ = ' ';
+        }
+    }
+    *out++ = ' ';
+    *out++ = '|';
+    for (size_t i = 0; i < count; i++)
+    {
+        *out++ = ((data[i] >= 0x20) && (data[i] < 0x7f)) ? (char)data[i] : '.';
+    }
+    *out++ = '|';
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+        if (i > 0)
+        {
+            *out++ = ' ';
+        }
+        if ((DUMP_BYTES_PER_LINE / 2) == i)
+        {
+            *out++ = ' ';
         }
+        out[0] = hexDigits[data[i] >> 4];
+        out[1] = hexDigits[data[i] & 0x0f];
+        out += 2;
     }
+#endif // LOG_DUMP_ASCII
 
-    return retVal;
+    *out++ = '\r';
+    *out++ = '\n';
+
+    return out;
 }
 
-eStatus LogSetLevel(const eLogLevel level)
+// Producer side of the sleep handshake in waitForRecord()
+static LOG_PORT_ISR_ATTR void wakeConsumer(void)
 {
-    eStatus retVal = eINVALIDARG;
-
-    if (level < eLogLevelCount)
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&consumerWaiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&consumerWaiting, false, __ATOMIC_RELAXED))
     {
-        currentLevel = level;
-        retVal = eOK;
+        LogPortSignal();
     }
-    else
+}
+
+// Whether a sink shows the human-readable time, so that it's worth keeping
+static bool timeStringWanted(void)
+{
+    bool retVal = false;
+
+    for (size_t i = 0; !retVal && (i < LOG_MAX_SINKS); i++)
     {
-        Log(eLogWarn, CMP_NAME, "Invalid log level: %d", level);
+        retVal = (eLogSinkFree != __atomic_load_n(&sinkSlots[i].State, __ATOMIC_RELAXED)) &&
+                 (0 != (sinkSlots[i].Format & eLogSinkFormatTimeString));
     }
 
     return retVal;
 }
 
-#define DUMP_BYTES_PER_LINE 16
-eStatus LogDumpBuffer(const eLogLevel level, const char * const component, const char * const function, const uint8_t * const buffer, size_t buffer_size)
+// Copies the human-readable time into out, which has room for
+// LOG_TIME_STRING_MAX chars, and returns how many it took. It's taken when the
+// message is logged rather than when LogTask() writes it out. Task context only
+static size_t putTimeString(uint8_t * const out)
 {
-    eStatus retVal = eOK;
-
-    char printBuf[DUMP_BYTES_PER_LINE * 3];  // 2 characters + separator/terminator
-    size_t processed = 0;
+    size_t retVal = 0;
 
-
-    while ((eOK == retVal) && (processed < buffer_size))
+    if (timeStringWanted())
     {
-        size_t toPrint = buffer_size - processed;
-        if (toPrint > DUMP_BYTES_PER_LINE)
-        {
-            toPrint = DUMP_BYTES_PER_LINE;
-        }
-
-        // print the first byte
-        sprintf(&(printBuf[0]), "%02X", buffer[processed]);
+        const char * const time = LogPortTimeGetString();
 
-        // Print the rest
-        for (size_t i = 1; i < toPrint; i++)
+        while ((retVal < LOG_TIME_STRING_MAX) && ('\0' != time[retVal]))
         {
-            // overwrite the null-termination of the previous sprintf
-            sprintf(&(printBuf[((i - 1)*3) + 2]), " %02X", buffer[processed + i]);
+            out[retVal] = (uint8_t)time[retVal];
+            retVal++;
         }
-
-        retVal = Log(level, component, function, "%s", printBuf);
-        processed += toPrint;
     }
+
     return retVal;
 }
 
-eStatus LogInit(void * params)
+// Every record starts with a timestamp, used only to merge the rings
+// A task migrating between reading the core id and committing merely ends up
+// in the other core's ring - the rings are multi-producer anyway
+static LogRing * producerRing(void)
 {
-    eStatus retVal = eOK;
-    bool oneSinkOk = false;
+    return &logRings[LogPortGetCoreId() % LOG_BUFFER_COUNT];
+}
 
-    (void)params;
+// Drops the oldest committed record of ring, if there is one. The sinks that
+// hadn't got it yet are told by dropped markers, one partway through it loses
+// the rest. One busy writing it out has a copy and sorts it out in
+// sinkAdvance(). A record reserved but not committed yet stops eviction, it
+// can't be dropped while its producer is still filling it in. Only the cursors
+// are moved under the port lock, the record is zeroed after
+static bool evictOldest(LogRing * const ring)
+{
+    const size_t index = (&logIsrRing == ring) ? LOG_BUFFER_COUNT : (size_t)(ring - logRings);
+    size_t size;
+    uint8_t type;
 
-    currentLevel = LOG_LEVEL_DEFAULT;   // default log level
+    LogPortLock();
+    const uint32_t from = claimEnd[index];
+    uint32_t position = from;
+    const bool retVal = (NULL != LogRingPeekAt(ring, &position, &size, &type));
+    const uint32_t to = retVal ? LogRingNext(ring, position) : position;
 
-    retVal = LogPortInit();
+    if (retVal)
+    {
+        statsAdd(&logStats.MessagesDropped, 1);
+        statsAdd(&logStats.MessagesEvicted, 1);
+    }
 
-    if (eOK == retVal)
+    // padding in front of it goes too, a sink may have been there as well
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
     {
-        for (size_t i = 0; i < ARRAY_SIZE(sinks); i++)
+        LogSinkCursor * const cursor = &sinkCursors[i];
+        if (sinkLive(i) && ((int32_t)(cursor->Position[index] - to) < 0))
         {
-            retVal = sinks[i].Init();
-            if (eOK == retVal)
+            const bool atHand = retVal && (cursor->Position[index] == position) && (index == cursor->Ring);
+
+            if (atHand && cursor->Busy)
             {
-                oneSinkOk = true;
+                cursor->Evicted = true;
             }
-            else
+            else if (retVal && ((int32_t)(cursor->Position[index] - position) <= 0))
             {
-                Log(eLogWarn, CMP_NAME, "LogInit: Error initializing %s sink", sinks[i].Name);
+                if (atHand && (cursor->Written > 0))
+                {
+                    cursor->Written = 0;
+                    cursor->Cut = true;
+                }
+                statsAdd(&cursor->Dropped, 1);
+                statsAdd(&logStats.Sinks[i].MessagesDropped, 1);
             }
+            cursor->Position[index] = to;
         }
-
-        retVal = (oneSinkOk) ? eOK : eFAILED;
     }
 
-#if (configSUPPORT_STATIC_ALLOCATION == 1)
-    logBuffer = xStreamBufferCreateStatic(LOG_BUFFER_SIZE, 1, logBufferStorage, &logBufferStruct);
-#else
-    logBuffer = xStreamBufferCreate(LOG_BUFFER_SIZE, 1);
-#endif
-
-    if (NULL != logBuffer)
+    if (to != from)
     {
-        initialized = true;
+        claimSpace(index, to);
     }
-    else
+    LogPortUnlock();
+
+    if (to != from)
     {
-        Log(eLogWarn, CMP_NAME, "LogInit: Error creating stream buffer!");
-        retVal = eFAILED;
+        releaseSpace(index, from, to);
     }
 
     return retVal;
 }
 
-eStatus LogTask(void)
+// Reserves size bytes, or extends record to size bytes if one is given
+static uint8_t * tryReserve(LogRing * const ring, uint8_t * const record, const size_t size)
 {
-    size_t toSend = getSinksSmallestWriteSize();
-    if (toSend > 0)
-    {
-        size_t toReceive = MIN(toSend, LOG_MAX_LINE_SIZE);
-        size_t received = xStreamBufferReceive(logBuffer, tmpReadBuf, toReceive, portMAX_DELAY);
-        sinksWrite(tmpReadBuf, received);
+    return (NULL == record) ? LogRingReserve(ring, size) : LogRingExtend(ring, record, size);
+}
+
+// Slow path of reserveRecord() and extendRecord(), task context only. There is
+// no point waiting for room to extend a record another one was reserved after,
+// nor for LogTask() to wait for or evict what it may be writing itself
+static uint8_t * reserveOnOverflow(LogRing * const ring, uint8_t * const record, const size_t size)
+{
+    uint8_t * retVal = NULL;
+
+    if (LogPortGetTaskId() == __atomic_load_n(&consumerTask, __ATOMIC_RELAXED))
+    {
+        // as for eLogOverflowDropNewest
+    }
+    else if (eLogOverflowBlock == overflowPolicy)
+    {
+        const uint32_t start = LogPortGetTimeMs();
+
+        while ((NULL == retVal) && ((LogPortGetTimeMs() - start) < blockTimeout) &&
+               ((NULL == record) || LogRingIsLast(ring, record)))
+        {
+            LogPortDelay(1);
+            retVal = tryReserve(ring, record, size);
+        }
+
+        statsAdd(&logStats.BlockWaitTime, LogPortGetTimeMs() - start);
+        statsAdd(&logStats.BlockTimeouts, (NULL == retVal) ? 1 : 0);
+    }
+    else if (eLogOverflowOverwriteOldest == overflowPolicy)
+    {
+        while ((NULL == retVal) && ((NULL == record) || LogRingIsLast(ring, record)) && evictOldest(ring))
+        {
+            retVal = tryReserve(ring, record, size);
+        }
+    }
+
+    return retVal;
+}
+
+// Applies the overflow policy when the ring is full. ISRs can neither wait nor
+// take the port lock for long, they always drop the new message
+static LOG_PORT_ISR_ATTR uint8_t * reserveRecord(LogRing * const ring, const size_t size)
+{
+    uint8_t * retVal = LogRingReserve(ring, size);
+
+    if ((NULL == retVal) && !LogPortInISR())
+    {
+        retVal = reserveOnOverflow(ring, NULL, size);
+    }
+
+    if (NULL == retVal)
+    {
+        statsAdd(&droppedCount, 1);
+        statsAdd(&logStats.MessagesDropped, 1);
+    }
+
+    return retVal;
+}
+
+// Reserves size bytes of payload in ring and stamps the record. Returns the
+// payload, to be filled in and handed to logCommit(), or NULL if full
+static LOG_PORT_ISR_ATTR uint8_t * logReserve(LogRing * const ring, const size_t size)
+{
+    uint8_t * retVal = NULL;
+    const uint32_t stamp = LogPortGetTimestamp();
+    uint8_t * record = reserveRecord(ring, sizeof(stamp) + size);
+
+    if (NULL != record)
+    {
+        memcpy(record, &stamp, sizeof(stamp));
+        retVal = &record[sizeof(stamp)];
+    }
+
+    return retVal;
+}
+
+// Commits the first size bytes of a payload from logReserve(), the rest of the
+// reservation goes back to the ring
+static LOG_PORT_ISR_ATTR void logCommit(LogRing * const ring, uint8_t * const payload, const size_t size, const eLogRecordType type)
+{
+    LogRingTrim(ring, payload - sizeof(uint32_t), sizeof(uint32_t) + size);
+    LogRingCommit(ring, payload - sizeof(uint32_t), (uint8_t)type);
+    wakeConsumer();
+    statsAdd(&logStats.MessagesAccepted, 1);
+    statsAdd(&logStats.BytesEnqueued, sizeof(uint32_t) + size);
+    statsUpdateHighWater(ring);
+}
+
+// Grows a record that is being filled in, applying the overflow policy like
+// reserveRecord() does. Task context only
+static uint8_t * extendRecord(LogRing * const ring, uint8_t * const record, const size_t size)
+{
+    uint8_t * retVal = LogRingExtend(ring, record, size);
+
+    if ((NULL == retVal) && LogRingIsLast(ring, record))
+    {
+        retVal = reserveOnOverflow(ring, record, size);
+    }
+
+    return retVal;
+}
+
+// Reserves the record of a dump that follows previous, a record of
+// previousSize bytes. It goes right behind previous if nothing else was
+// reserved after that meanwhile, so that the dump stays in one piece, and
+// wherever there is room otherwise. previous may move like with
+// LogRingExtend(). Task context only
+static uint8_t * reserveDumpRecord(LogRing * const ring, uint8_t ** const previous, const size_t previousSize, const size_t size)
+{
+    uint8_t * retVal = NULL;
+    uint8_t * const grown = extendRecord(ring, *previous, previousSize + LOG_RING_HEADER_SIZE + (LOG_RING_ALIGN - 1) + size);
+
+    if (NULL != grown)
+    {
+        *previous = grown;
+        retVal = LogRingSplit(ring, grown, previousSize);
+    }
+    else if (!LogRingIsLast(ring, *previous))
+    {
+        retVal = tryReserve(ring, NULL, size);
+        if (NULL == retVal)
+        {
+            retVal = reserveOnOverflow(ring, NULL, size);
+        }
+    }
+
+    return retVal;
+}
+
+// Ring space a dump part of size bytes may take: each record takes a ring
+// header, a timestamp and a dump header, and may need aligning. At the end of
+// the buffer, the padding and a record moved from there to its start take up
+// to two records more
+static size_t dumpPartSpace(const size_t size, const size_t prefix, const size_t perRecord)
+{
+    const size_t count = (size > 0) ? (((size - 1) / perRecord) + 1) : 1;
+
+    return size + (count * (LOG_RING_HEADER_SIZE + sizeof(uint32_t) + prefix + LOG_RING_ALIGN)) +
+           (2 * (LOG_RING_HEADER_SIZE + sizeof(uint32_t) + LOG_MAX_RECORD_SIZE));
+}
+
+// Waits up to LOG_DUMP_PART_WAIT ms for LogTask() to leave space bytes free in
+// ring. Task context only
+static void waitForSpace(const LogRing * const ring, const size_t space)
+{
+    const uint32_t start = LogPortGetTimeMs();
+
+    while ((LogPortGetTaskId() != __atomic_load_n(&consumerTask, __ATOMIC_RELAXED)) &&
+           ((__atomic_load_n(&ring->Head, __ATOMIC_RELAXED) - __atomic_load_n(&ring->Tail, __ATOMIC_RELAXED)) >
+            (ring->Size - space)) && ((LogPortGetTimeMs() - start) < LOG_DUMP_PART_WAIT))
+    {
+        LogPortDelay(1);
+    }
+}
+
+// Logs size bytes of a dump, starting at offset, as records of perRecord bytes
+// of data following the header and the time string. They are all reserved
+// before any is committed, so that the part makes it in whole or not at all,
+// and one behind the other as long as no other producer gets in between.
+// Task context only
+static eStatus logDumpPart(LogRing * const ring, LogDumpHeader * const header, const uint8_t * const timeString,
+        const uint8_t * const buffer, const size_t offset, const size_t size, const size_t perRecord)
+{
+    eStatus retVal = eOK;
+    const size_t prefix = sizeof(*header) + header->TimeLength;
+    const size_t count = (size > 0) ? (((size - 1) / perRecord) + 1) : 1;
+    // a part can't have more records than this, see LogDumpBuffer()
+    uint8_t * records[(LOG_RING_SIZE / (LOG_MAX_RECORD_SIZE - sizeof(LogDumpHeader) - LOG_TIME_STRING_MAX)) + 1];
+    size_t reserved = 0;
+
+    for (reserved = 0; (eOK == retVal) && (reserved < count); reserved++)
+    {
+        const size_t start = reserved * perRecord;
+        const size_t recordSize = prefix + MIN(size - start, perRecord);
+        uint8_t * payload = NULL;
+
+        if (0 == reserved)
+        {
+            payload = logReserve(ring, recordSize);
+        }
+        else
+        {
+            // all of them carry the timestamp of the first one
+            const size_t previousSize = prefix + perRecord;
+            uint8_t * previous = records[reserved - 1] - sizeof(uint32_t);
+            uint8_t * const record = reserveDumpRecord(ring, &previous, sizeof(uint32_t) + previousSize,
+                    sizeof(uint32_t) + recordSize);
+
+            records[reserved - 1] = &previous[sizeof(uint32_t)];
+            if (NULL != record)
+            {
+                memcpy(record, previous, sizeof(uint32_t));
+                payload = &record[sizeof(uint32_t)];
+            }
+        }
+
+        if (NULL == payload)
+        {
+            retVal = eBUSY;
+            break;
+        }
+
+        header->Offset = (uint32_t)(offset + start);
+        memcpy(payload, header, sizeof(*header));
+        memcpy(&payload[sizeof(*header)], timeString, header->TimeLength);
+        memcpy(&payload[prefix], &buffer[offset + start], recordSize - prefix);
+        records[reserved] = payload;
+    }
+
+    for (size_t i = 0; i < reserved; i++)
+    {
+        if (eOK == retVal)
+        {
+            const size_t start = i * perRecord;
+            logCommit(ring, records[i], prefix + MIN(size - start, perRecord), eLogRecordDump);
+        }
+        else
+        {
+            LogRingDiscard(ring, records[i] - sizeof(uint32_t));
+        }
+    }
+
+    // logReserve() counted the drop if the first record didn't fit already
+    if ((eBUSY == retVal) && (reserved > 0))
+    {
+        wakeConsumer();
+        statsAdd(&droppedCount, 1);
+        statsAdd(&logStats.MessagesDropped, 1);
+    }
+
+    return retVal;
+}
+
+#if (LOG_DEFERRED_FORMAT == 1)
+// Packs straight into the ring, reserving a line and trimming it to what the
+// arguments took
+static eStatus logDeferred(const eLogLevel level, const char * const component, const char * const function, va_list args)
+{
+    eStatus retVal = eBUSY;
+    LogRing * const ring = producerRing();
+    uint8_t * const payload = logReserve(ring, LOG_MAX_LINE_SIZE);
+
+    if (NULL != payload)
+    {
+        LogDeferredHeader header;
+        const char * fmt = va_arg(args, char *);
+        const size_t timeLength = putTimeString(&payload[sizeof(header)]);
+        const size_t prefix = sizeof(header) + timeLength;
+
+        header.Level = (uint8_t)level;
+        header.TimeLength = (uint8_t)timeLength;
+        header.Time = LogPortGetTimeMs();
+        header.Component = component;
+        header.Function = function;
+        header.Format = fmt;
+        memcpy(payload, &header, sizeof(header));
+
+        bool truncated = false;
+        size_t packed = LogDeferredPack(&payload[prefix], LOG_MAX_LINE_SIZE - prefix, fmt, args, &truncated);
+        if (truncated)
+        {
+            statsAdd(&logStats.MessagesTruncated, 1);
+        }
+
+        logCommit(ring, payload, prefix + packed, eLogRecordDeferred);
+        retVal = eOK;
+    }
+
+    return retVal;
+}
+
+#else // !LOG_DEFERRED_FORMAT
+
+// Moves a record another one was reserved after to a new one of size bytes,
+// which is reserved like any other. The timestamp goes along, the merge order
+// stays that of the Log() call
+static uint8_t * moveRecord(LogRing * const ring, uint8_t * const record, const size_t used, const size_t size)
+{
+    uint8_t * retVal = LogRingReserve(ring, size);
+
+    if (NULL == retVal)
+    {
+        retVal = reserveOnOverflow(ring, NULL, size);
+    }
+
+    if (NULL != retVal)
+    {
+        memcpy(retVal, record, used);
+        LogRingDiscard(ring, record);
+    }
+
+    return retVal;
+}
+
+// Grows the record logImmediate() formats into, by a line if there's room right
+// away and up to LOG_MAX_RECORD_SIZE. Past that the message is cut short and
+// counted as truncated. If the overflow policy gives up on a full buffer the
+// grow fails and logImmediate() drops the message, so that it's never cut short
+// for lack of room
+static bool growRecord(LogFormatBuffer * const buffer, const size_t size)
+{
+    LogGrowContext * const context = (LogGrowContext *)buffer->Context;
+    uint8_t * const record = (uint8_t *)buffer->Data - context->Prefix - sizeof(uint32_t);
+    const size_t wanted = context->Prefix + size;
+    const size_t capacity = context->Prefix + buffer->Size;
+    const size_t needed = MIN(wanted, (size_t)LOG_MAX_RECORD_SIZE);
+    const size_t step = MIN(capacity + LOG_MAX_LINE_SIZE, (size_t)LOG_MAX_RECORD_SIZE);
+    size_t granted = MAX(needed, step);
+    uint8_t * grown = NULL;
+
+    if (needed > capacity)
+    {
+        grown = LogRingExtend(context->Ring, record, sizeof(uint32_t) + granted);
+        if (NULL == grown)
+        {
+            granted = needed;
+            grown = extendRecord(context->Ring, record, sizeof(uint32_t) + granted);
+        }
+        if ((NULL == grown) && !LogRingIsLast(context->Ring, record))
+        {
+            grown = moveRecord(context->Ring, record, sizeof(uint32_t) + context->Prefix + buffer->Length,
+                    sizeof(uint32_t) + granted);
+        }
+        context->Failed = (NULL == grown);
+    }
+
+    if (NULL != grown)
+    {
+        buffer->Data = (char *)&grown[sizeof(uint32_t) + context->Prefix];
+        buffer->Size = granted - context->Prefix;
+    }
+
+    // once at the cap there's no asking again, so this counts each message once
+    if (!context->Failed && (needed < wanted))
+    {
+        statsAdd(&logStats.MessagesTruncated, 1);
+    }
+
+    return (NULL != grown) && (needed == wanted);
+}
+
+static eStatus logImmediate(const eLogLevel level, const char * const component, const char * const function, va_list args)
+{
+    eStatus retVal = eBUSY;
+    LogRing * const ring = producerRing();
+    uint8_t * const payload = logReserve(ring, LOG_MAX_LINE_SIZE);
+
+    if (NULL != payload)
+    {
+        LogTextHeader header;
+        LogFormatBuffer buffer;
+        const size_t timeLength = putTimeString(&payload[sizeof(header)]);
+        LogGrowContext context = { ring, sizeof(header) + timeLength, false };
+
+        header.Level = (uint8_t)level;
+        header.TimeLength = (uint8_t)timeLength;
+        header.Time = LogPortGetTimeMs();
+        header.Component = component;
+        header.Function = function;
+        memcpy(payload, &header, sizeof(header));
+
+        LogFormatInit(&buffer, (char *)&payload[context.Prefix], LOG_MAX_LINE_SIZE - context.Prefix);
+        buffer.Grow = growRecord;
+        buffer.Context = &context;
+
+        const char * fmt = va_arg(args, char *);
+        LogFormatV(&buffer, fmt, args);
+
+        // growing may have moved the record
+        uint8_t * const record = (uint8_t *)buffer.Data - context.Prefix;
+        if (context.Failed)
+        {
+            LogRingDiscard(ring, record - sizeof(uint32_t));
+            wakeConsumer();
+            statsAdd(&droppedCount, 1);
+            statsAdd(&logStats.MessagesDropped, 1);
+        }
+        else
+        {
+            logCommit(ring, record, context.Prefix + buffer.Length, eLogRecordText);
+            retVal = eOK;
+        }
+    }
+
+    return retVal;
+}
+#endif // LOG_DEFERRED_FORMAT
+
+// Renders deferred records - both those of LOG_DEFERRED_FORMAT and those
+// coming from LogFromISR(). data is what follows the header
+static size_t renderDeferred(const uint32_t format, const LogDeferredHeader * const header, const uint8_t * const data,
+        const size_t dataSize, char * const out, const size_t size)
+{
+    LogFormatBuffer buffer;
+
+    LogFormatInit(&buffer, out, size - LOG_TRAILER_MAX_SIZE);
+    formatHeader(&buffer, format, (eLogLevel)header->Level, header->Time, (const char *)data, header->TimeLength,
+            header->Component, header->Function);
+    LogDeferredRender(&buffer, header->Format, &data[header->TimeLength], dataSize - header->TimeLength);
+    formatTrailer(&buffer, format);
+
+    return buffer.Length;
+}
+
+// Ends the line of a message evicted while sink i was partway through it.
+// Returns the number of bytes written
+static size_t endCutLine(const size_t sink)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+    char trailer[LOG_TRAILER_MAX_SIZE];
+    LogFormatBuffer buffer;
+
+    LogFormatInit(&buffer, trailer, 0);
+    if (__atomic_exchange_n(&cursor->Cut, false, __ATOMIC_RELAXED))
+    {
+        formatTrailer(&buffer, cursor->Format);
+        sinkWrite(sink, (const uint8_t *)trailer, buffer.Length);
+    }
+
+    return buffer.Length;
+}
+
+// Tells sink i how many messages it lost since the last time, in between two
+// messages. Messages still in the buffer from before the gap may come after it
+static void writeDroppedMarker(const size_t sink)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+
+    if ((0 != cursor->Dropped) && (0 == cursor->Written) && (0 != sinkGetBudget(sink)))
+    {
+        sinkSlots[sink].Budget -= MIN(sinkSlots[sink].Budget, endCutLine(sink));
+        const uint32_t dropped = __atomic_exchange_n(&cursor->Dropped, 0, __ATOMIC_RELAXED);
+        const uint32_t format = sinkSlots[sink].Format;
+        LogFormatBuffer buffer;
+
+        LogFormatInit(&buffer, (char *)tmpReadBuf, sizeof(tmpReadBuf) - LOG_TRAILER_MAX_SIZE);
+        const char * const timeString = LogPortTimeGetString();
+        formatHeader(&buffer, format, eLogWarn, LogPortGetTimeMs(), timeString, strlen(timeString), CMP_NAME, "LogTask");
+        LogFormatDecimal(&buffer, dropped, 0);
+        LogFormatString(&buffer, (1 == dropped) ? " message dropped" : " messages dropped");
+        formatTrailer(&buffer, format);
+
+        sinkWrite(sink, tmpReadBuf, buffer.Length);
+        sinkSlots[sink].Budget -= MIN(sinkSlots[sink].Budget, buffer.Length);
+    }
+}
+
+// Renders a dump record for sink i as hex text, with text holding as many
+// lines at a time as fit. The header line is colored like any message, the
+// hex lines are not. Returns the number of bytes handed to the sink
+static size_t writeDump(const size_t sink, const uint8_t * const record, const size_t size, char * const text, const size_t textSize)
+{
+    size_t retVal = 0;
+    LogDumpHeader header;
+    const uint32_t format = sinkSlots[sink].Format;
+    LogFormatBuffer out;
+
+    memcpy(&header, record, sizeof(header));
+
+    const char * const timeString = (const char *)&record[sizeof(header)];
+    const uint8_t * const data = &record[sizeof(header) + header.TimeLength];
+    const size_t count = size - sizeof(header) - header.TimeLength;
+
+    const size_t offsetDigits = (header.Total > 0x10000) ? 8 : 4;
+    const size_t fullLine = dumpLineLength(DUMP_BYTES_PER_LINE, offsetDigits);
+
+    LogFormatInit(&out, text, textSize - LOG_TRAILER_MAX_SIZE);
+    formatHeader(&out, format, (eLogLevel)header.Level, header.Time, timeString, header.TimeLength,
+            header.Component, header.Function);
+    LogFormatDecimal(&out, header.Total, 0);
+    LogFormatString(&out, " bytes");
+    if (header.Parts > 1)
+    {
+        LogFormatString(&out, ", part ");
+        LogFormatDecimal(&out, header.Part, 0);
+        LogFormatChar(&out, '/');
+        LogFormatDecimal(&out, header.Parts, 0);
+    }
+    if (0 != header.Offset)
+    {
+        LogFormatString(&out, ", continued");
+    }
+    formatTrailer(&out, format);
+
+    size_t used = out.Length;
+    for (size_t i = 0; i < count; i += DUMP_BYTES_PER_LINE)
+    {
+        if ((textSize - used) < fullLine)
+        {
+            sinkWriteBlock(sink, (const uint8_t *)text, used);
+            retVal += used;
+            used = 0;
+        }
+        used = formatDumpLine(&text[used], header.Offset + i, offsetDigits, &data[i],
+                MIN((size_t)DUMP_BYTES_PER_LINE, count - i)) - text;
+    }
+
+    sinkWriteBlock(sink, (const uint8_t *)text, used);
+    retVal += used;
+
+    return retVal;
+}
+
+// A record evicted while sink i was busy with it. The cursor was moved past it
+// already; unless it got written out whole, the sink lost the rest. Cursors
+// lock held
+static void settleEvicted(const size_t sink, const bool lost)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+
+    if (lost)
+    {
+        cursor->Cut = (cursor->Written > 0);
+        statsAdd(&cursor->Dropped, 1);
+        statsAdd(&logStats.Sinks[sink].MessagesDropped, 1);
+    }
+    cursor->Written = 0;
+    cursor->Evicted = false;
+}
+
+// The part of sinkPeek() done under the cursors lock: finding the record and
+// marking the sink busy with it
+static const uint8_t * peekOldest(const size_t sink, size_t * const size, uint8_t * const type)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+    const uint8_t * retVal = NULL;
+    uint32_t oldest = 0;
+
+    cursorsLock();
+    for (size_t r = 0; r < LOG_RING_COUNT; r++)
+    {
+        size_t recordSize;
+        uint8_t recordType;
+        const uint8_t * record = NULL;
+
+        if ((0 == cursor->Written) || (r == cursor->Ring))
+        {
+            record = LogRingPeekAt(ringAt(r), &cursor->Position[r], &recordSize, &recordType);
+        }
+
+        if (NULL != record)
+        {
+            uint32_t stamp;
+            memcpy(&stamp, record, sizeof(stamp));
+
+            // wrap-safe comparison
+            if ((NULL == retVal) || ((int32_t)(stamp - oldest) < 0))
+            {
+                retVal = record;
+                oldest = stamp;
+                cursor->Ring = r;
+                *size = recordSize;
+                *type = recordType;
+            }
+        }
+    }
+
+    if ((NULL != retVal) && (eLogOverflowOverwriteOldest == overflowPolicy))
+    {
+        cursor->Busy = true;
+    }
+    cursorsUnlock();
+
+    return retVal;
+}
+
+// The record sink i is partway through, or else the oldest one it hasn't got
+// across all rings, without the timestamp. Records reserved but not yet
+// committed are not waited for, so ordering across cores is best effort. With
+// eLogOverflowOverwriteOldest the sink is marked busy with the record until
+// sinkAdvance() and it is copied out after the lock is let go. A copy of one
+// evicted meanwhile may be torn, the next record is tried instead
+static const uint8_t * sinkPeek(const size_t sink, size_t * const size, uint8_t * const type)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+    const uint8_t * retVal = NULL;
+    bool torn;
+
+    do
+    {
+        retVal = peekOldest(sink, size, type);
+        torn = false;
+
+        if ((NULL != retVal) && (eLogOverflowOverwriteOldest == overflowPolicy))
+        {
+            *size = MIN(*size, sizeof(recordCopy));
+            memcpy(recordCopy, retVal, *size);
+            retVal = recordCopy;
+
+            cursorsLock();
+            torn = cursor->Evicted;
+            if (torn)
+            {
+                settleEvicted(sink, true);
+                cursor->Busy = false;
+            }
+            cursorsUnlock();
+        }
+    } while (torn);
+
+    if (NULL != retVal)
+    {
+        *size -= sizeof(uint32_t);
+        retVal = &retVal[sizeof(uint32_t)];
+    }
+
+    return retVal;
+}
+
+// Moves sink i past its record once all size bytes of it have been written
+static void sinkAdvance(const size_t sink, const size_t written, const size_t size)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+
+    cursorsLock();
+    if (cursor->Evicted)
+    {
+        cursor->Written = written;
+        settleEvicted(sink, written < size);
+    }
+    else if (written < size)
+    {
+        cursor->Written = written;
+    }
+    else
+    {
+        cursor->Position[cursor->Ring] = LogRingNext(ringAt(cursor->Ring), cursor->Position[cursor->Ring]);
+        cursor->Written = 0;
+    }
+    cursor->Busy = false;
+    cursorsUnlock();
+}
+
+static bool sinkHasRecord(const size_t sink)
+{
+    bool retVal = false;
+
+    cursorsLock();
+    for (size_t r = 0; !retVal && (r < LOG_RING_COUNT); r++)
+    {
+        uint32_t position = sinkCursors[sink].Position[r];
+        size_t size;
+        uint8_t type;
+
+        retVal = (NULL != LogRingPeekAt(ringAt(r), &position, &size, &type));
+    }
+    cursorsUnlock();
+
+    return retVal;
+}
+
+// One round for sink i: writes what it hasn't got yet, as long as the sink has
+// room for it, but no more than the whole buffer holds - with producers going
+// all the time it would never end otherwise. Dumps are written whole once
+// started. Returns true if the sink ran out of room before running out of
+// messages
+static bool drainSink(const size_t sink)
+{
+    LogSinkCursor * const cursor = &sinkCursors[sink];
+    size_t roundLeft = sizeof(logBufferStorage) + sizeof(logIsrBufferStorage);
+    size_t budget = 0;
+    const uint8_t * record = NULL;
+    size_t size = 0;
+    uint8_t type = 0;
+
+    while ((roundLeft > 0) && (0 != (budget = MIN(sinkGetBudget(sink), roundLeft))) &&
+           (NULL != (record = sinkPeek(sink, &size, &type))))
+    {
+        const size_t before = budget;
+        const eLogLevel level = (eLogLevel)record[0];
+
+        if (0 == cursor->Written)
+        {
+            budget -= MIN(budget, endCutLine(sink));
+        }
+
+        if ((0 == cursor->Written) && (level < sinkSlots[sink].Level))
+        {
+            // not for this sink, skipped before anything is rendered
+            roundLeft -= MIN(roundLeft, size);
+            sinkAdvance(sink, size, size);
+        }
+        else if (eLogRecordDump == type)
+        {
+#if (LOG_BATCH_SIZE > 0)
+            // rendered in batchBuf, so whatever is in there goes out first
+            sinkFlush(sink);
+            const size_t written = writeDump(sink, record, size, (char *)batchBuf, sizeof(batchBuf));
+#else
+            const size_t written = writeDump(sink, record, size, (char *)tmpReadBuf, sizeof(tmpReadBuf));
+#endif // LOG_BATCH_SIZE
+            budget -= MIN(budget, written);
+            sinkAdvance(sink, size, size);
+        }
+        else
+        {
+            // rendered again for every sink, and for every round it takes
+            char trailer[LOG_TRAILER_MAX_SIZE];
+            LogSpan spans[3];
+            size_t spanCount = 0;
+            LogFormatBuffer buffer;
+
+            if (0 == cursor->Written)
+            {
+                cursor->Format = sinkSlots[sink].Format;
+            }
+            const uint32_t format = cursor->Format;
+
+            if (eLogRecordDeferred == type)
+            {
+                LogDeferredHeader header;
+                memcpy(&header, record, sizeof(header));
+                spans[spanCount].Data = tmpReadBuf;
+                spans[spanCount++].Size = renderDeferred(format, &header, &record[sizeof(header)],
+                        size - sizeof(header), (char *)tmpReadBuf, sizeof(tmpReadBuf));
+            }
+            else
+            {
+                // the message text goes out straight from the record
+                LogTextHeader header;
+                memcpy(&header, record, sizeof(header));
+                LogFormatInit(&buffer, (char *)tmpReadBuf, sizeof(tmpReadBuf));
+                formatHeader(&buffer, format, (eLogLevel)header.Level, header.Time, (const char *)&record[sizeof(header)],
+                        header.TimeLength, header.Component, header.Function);
+                spans[spanCount].Data = tmpReadBuf;
+                spans[spanCount++].Size = buffer.Length;
+                spans[spanCount].Data = &record[sizeof(header) + header.TimeLength];
+                spans[spanCount++].Size = size - sizeof(header) - header.TimeLength;
+                LogFormatInit(&buffer, trailer, 0);
+                formatTrailer(&buffer, format);
+                spans[spanCount].Data = (const uint8_t *)trailer;
+                spans[spanCount++].Size = buffer.Length;
+            }
+
+            size_t total = 0;
+            for (size_t i = 0; i < spanCount; i++)
+            {
+                total += spans[i].Size;
+            }
+
+            const size_t count = MIN(total - cursor->Written, budget);
+            sinkWriteSpans(sink, spans, spanCount, cursor->Written, count);
+            budget -= count;
+            sinkAdvance(sink, cursor->Written + count, total);
+        }
+
+        roundLeft -= before - budget;
+        sinkSlots[sink].Budget -= before - budget;
+
+        // an error may well be followed by a crash, it goes all the way out
+        if ((before != budget) && (0 == cursor->Written) && (level >= LOG_SINK_FLUSH_LEVEL))
+        {
+            sinkSync(sink);
+        }
+    }
+
+    writeDroppedMarker(sink);
+    sinkFlush(sink);
+
+    return ((0 == budget) && (0 != roundLeft) && sinkHasRecord(sink));
+}
+
+// A sink more than LOG_SINK_MAX_LAG behind the one furthest ahead skips its
+// oldest messages until it isn't any more. Never the one it is partway through
+static void skipLagging(void)
+{
+    for (size_t r = 0; r < LOG_RING_COUNT; r++)
+    {
+        LogRing * const ring = ringAt(r);
+        const uint32_t maxLag = (ring->Size / 100) * LOG_SINK_MAX_LAG;
+
+        cursorsLock();
+        uint32_t lead = claimEnd[r];
+        for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+        {
+            if (sinkLive(i) && ((int32_t)(sinkCursors[i].Position[r] - lead) > 0))
+            {
+                lead = sinkCursors[i].Position[r];
+            }
+        }
+
+        for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+        {
+            LogSinkCursor * const cursor = &sinkCursors[i];
+            size_t size;
+            uint8_t type;
+
+            while (sinkLive(i) && ((lead - cursor->Position[r]) > maxLag) && ((0 == cursor->Written) || (r != cursor->Ring)) &&
+                   (NULL != LogRingPeekAt(ring, &cursor->Position[r], &size, &type)))
+            {
+                cursor->Position[r] = LogRingNext(ring, cursor->Position[r]);
+                statsAdd(&cursor->Dropped, 1);
+                statsAdd(&logStats.Sinks[i].MessagesDropped, 1);
+            }
+        }
+        cursorsUnlock();
+    }
+}
+
+// Gives back the space all sinks are done with. Without any sinks, whatever
+// has been committed goes
+static void reclaimSpace(void)
+{
+    for (size_t r = 0; r < LOG_RING_COUNT; r++)
+    {
+        LogRing * const ring = ringAt(r);
+        bool anySink = false;
+        size_t size;
+        uint8_t type;
+
+        cursorsLock();
+        uint32_t slowest = claimEnd[r];
+        for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+        {
+            if (sinkLive(i) && (!anySink || ((int32_t)(sinkCursors[i].Position[r] - slowest) < 0)))
+            {
+                slowest = sinkCursors[i].Position[r];
+                anySink = true;
+            }
+        }
+        while (!anySink && (NULL != LogRingPeekAt(ring, &slowest, &size, &type)))
+        {
+            slowest = LogRingNext(ring, slowest);
+        }
+
+        const bool claimed = (slowest != claimEnd[r]);
+        const uint32_t from = claimed ? claimSpace(r, slowest) : slowest;
+        cursorsUnlock();
+
+        if (claimed)
+        {
+            releaseSpace(r, from, slowest);
+        }
+    }
+}
+
+static bool anySinkHasRecord(void)
+{
+    bool retVal = false;
+
+    for (size_t i = 0; !retVal && (i < LOG_MAX_SINKS); i++)
+    {
+        retVal = sinkLive(i) && sinkHasRecord(i);
+    }
+
+    return retVal;
+}
+
+// Waits up to waitTime ms for a record to commit. The flag is raised before
+// the last look at the rings, so a producer committing in between either gets
+// seen here or sees the flag and signals. With newOnly set any record already
+// there doesn't count, which is when sinks are waited on to make room
+static bool waitForRecord(const size_t waitTime, const bool newOnly)
+{
+    bool retVal = !newOnly && anySinkHasRecord();
+    bool waited = false;
+
+    while (!retVal && !waited)
+    {
+        __atomic_store_n(&consumerWaiting, true, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        retVal = !newOnly && anySinkHasRecord();
+        if (!retVal)
+        {
+            retVal = LogPortWait(waitTime) || anySinkHasRecord();
+            waited = (LOG_PORT_WAIT_FOREVER != waitTime);
+        }
+
+        __atomic_store_n(&consumerWaiting, false, __ATOMIC_RELAXED);
+    }
+
+    return retVal;
+}
+
+// ms until the first sink is due a flush, LOG_PORT_WAIT_FOREVER if none is
+static size_t nextFlush(void)
+{
+    size_t retVal = LOG_PORT_WAIT_FOREVER;
+    const uint32_t now = LogPortGetTimeMs();
+
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+    {
+        if (sinkLive(i) && sinkSlots[i].Dirty)
+        {
+            const uint32_t elapsed = now - sinkSlots[i].DirtyTime;
+            retVal = MIN(retVal, (size_t)((elapsed < LOG_SINK_FLUSH_INTERVAL) ? (LOG_SINK_FLUSH_INTERVAL - elapsed) : 0));
+        }
+    }
+
+    return retVal;
+}
+
+static void flushDue(void)
+{
+    const uint32_t now = LogPortGetTimeMs();
+
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+    {
+        if (sinkLive(i) && sinkSlots[i].Dirty && ((now - sinkSlots[i].DirtyTime) >= LOG_SINK_FLUSH_INTERVAL))
+        {
+            sinkSync(i);
+        }
+    }
+}
+
+#if (LOG_BATCH_SIZE > 0)
+static size_t queuedBytes(void)
+{
+    size_t retVal = 0;
+
+    for (size_t r = 0; r < LOG_RING_COUNT; r++)
+    {
+        retVal += __atomic_load_n(&ringAt(r)->Head, __ATOMIC_RELAXED) - __atomic_load_n(&ringAt(r)->Tail, __ATOMIC_RELAXED);
+    }
+
+    return retVal;
+}
+
+// Lets a batch build up: waits for more records until LOG_BATCH_SIZE bytes are
+// queued or LOG_BATCH_MAX_LATENCY has passed since the first one
+static void waitForBatch(void)
+{
+    const uint32_t start = LogPortGetTimeMs();
+    uint32_t elapsed = 0;
+
+    while ((queuedBytes() < (LOG_BATCH_SIZE - LOG_MAX_LINE_SIZE)) && (elapsed < LOG_BATCH_MAX_LATENCY))
+    {
+        waitForRecord(LOG_BATCH_MAX_LATENCY - elapsed, true);
+        elapsed = LogPortGetTimeMs() - start;
+    }
+}
+#endif // LOG_BATCH_SIZE
+
+// The slot of a registered sink, LOG_MAX_SINKS if there's none
+static size_t findSink(const LogSink * const sink)
+{
+    size_t retVal = LOG_MAX_SINKS;
+
+    for (size_t i = 0; (LOG_MAX_SINKS == retVal) && (NULL != sink) && (i < LOG_MAX_SINKS); i++)
+    {
+        const eLogSinkState state = __atomic_load_n(&sinkSlots[i].State, __ATOMIC_ACQUIRE);
+        if ((sink == sinkSlots[i].Sink) && ((eLogSinkAdded == state) || (eLogSinkActive == state)))
+        {
+            retVal = i;
+        }
+    }
+
+    return retVal;
+}
+
+// Whether sink is in a slot other than the given one, registered or being
+// added
+static bool sinkElsewhere(const LogSink * const sink, const size_t slot)
+{
+    bool retVal = false;
+
+    for (size_t i = 0; !retVal && (i < LOG_MAX_SINKS); i++)
+    {
+        const eLogSinkState state = __atomic_load_n(&sinkSlots[i].State, __ATOMIC_ACQUIRE);
+        retVal = (i != slot) && (sink == __atomic_load_n(&sinkSlots[i].Sink, __ATOMIC_RELAXED)) &&
+                 ((eLogSinkClaimed == state) || (eLogSinkAdded == state) || (eLogSinkActive == state));
+    }
+
+    return retVal;
+}
+
+// Claims a slot, initializes sink and hands it to LogTask(), which starts
+// writing to it on its next round. The sink is put in the slot before looking
+// for it in the others, so of two tasks adding it at once at least one sees
+// the other and backs off - it is never initialized twice
+static eStatus addSink(const LogSink * const sink)
+{
+    eStatus retVal = eOK;
+    size_t slot = LOG_MAX_SINKS;
+
+    if ((NULL == sink) || (NULL == sink->Init) || (NULL == sink->GetWriteSize) || (NULL == sink->Write))
+    {
+        retVal = eINVALIDARG;
+    }
+
+    for (size_t i = 0; (eOK == retVal) && (LOG_MAX_SINKS == slot) && (i < LOG_MAX_SINKS); i++)
+    {
+        eLogSinkState expected = eLogSinkFree;
+        if (__atomic_compare_exchange_n(&sinkSlots[i].State, &expected, eLogSinkClaimed, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            slot = i;
+        }
+    }
+
+    if ((eOK == retVal) && (LOG_MAX_SINKS == slot))
+    {
+        retVal = eFAILED;           // registry full
+    }
+    else if (eOK == retVal)
+    {
+        __atomic_store_n(&sinkSlots[slot].Sink, sink, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (sinkElsewhere(sink, slot))
+        {
+            retVal = eINVALIDARG;   // already there
+        }
+    }
+
+    if (eOK == retVal)
+    {
+        retVal = sink->Init();
+    }
+
+    if (eOK == retVal)
+    {
+        sinkSlots[slot].Level = eLogTrace;
+        sinkSlots[slot].Format = LOG_SINK_FORMAT_DEFAULT;
+        memset(&logStats.Sinks[slot], 0, sizeof(logStats.Sinks[slot]));
+        __atomic_store_n(&sinkSlots[slot].State, eLogSinkAdded, __ATOMIC_RELEASE);
+        wakeConsumer();
+    }
+    else if (LOG_MAX_SINKS != slot)
+    {
+        freeSlot(slot);
+    }
+
+    return retVal;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+eStatus Log(const eLogLevel level, const char * const component, const char * const function, ...)
+{
+    eStatus retVal = eOK;
+
+    if (!initialized)
+    {
+        retVal = eNOTINITIALIZED;
+    }
+    else if (LogPortInISR())
+    {
+        // not a good idea to call prinf and friends inside an ISR
+        retVal = eUNSUPPORTED;
+    }
+    else if (level >= eLogLevelCount)
+    {
+        retVal = eINVALIDARG;
+    }
+
+    if (eOK == retVal)
+    {
+        if (level >= LogCurrentLevel)
+        {
+            va_list args;
+            va_start(args, function);
+#if (LOG_DEFERRED_FORMAT == 1)
+            retVal = logDeferred(level, component, function, args);
+#else
+            retVal = logImmediate(level, component, function, args);
+#endif // LOG_DEFERRED_FORMAT
+            va_end(args);
+        }
+        else
+        {
+            statsAdd(&LogFilteredCount, 1);
+        }
+    }
+
+    return retVal;
+}
+
+LOG_PORT_ISR_ATTR eStatus LogFromISR(const eLogLevel level, const char * const component, const char * const function, const char * const format, const size_t argCount, ...)
+{
+    eStatus retVal = eOK;
+
+    if (!initialized)
+    {
+        retVal = eNOTINITIALIZED;
+    }
+    else if (level >= eLogLevelCount)
+    {
+        retVal = eINVALIDARG;
+    }
+
+    if ((eOK == retVal) && (level >= LogCurrentLevel))
+    {
+        // Same layout as LogDeferredPack() produces for int-sized conversions,
+        // so LogTask() renders it like any deferred record
+        LogDeferredHeader header;
+        const size_t count = MIN(argCount, (size_t)LOG_ISR_MAX_ARGS);
+        const size_t size = sizeof(header) + (count * sizeof(uint32_t));
+        uint8_t * const payload = logReserve(&logIsrRing, size);
+
+        if (NULL == payload)
+        {
+            retVal = eBUSY;
+        }
+        else
+        {
+            va_list args;
+
+            header.Level = (uint8_t)level;
+            header.TimeLength = 0;      // LogPortTimeGetString() isn't ISR-safe
+            header.Time = LogPortGetTimeMs();
+            header.Component = component;
+            header.Function = function;
+            header.Format = format;
+            memcpy(payload, &header, sizeof(header));
+
+            va_start(args, argCount);
+            for (size_t i = 0; i < count; i++)
+            {
+                // promoted to int, which uint32_t (unsigned long on some
+                // toolchains) need not be
+                uint32_t value = va_arg(args, unsigned int);
+                memcpy(&payload[sizeof(header) + (i * sizeof(value))], &value, sizeof(value));
+            }
+            va_end(args);
+
+            logCommit(&logIsrRing, payload, size, eLogRecordDeferred);
+        }
+    }
+    else if (eOK == retVal)
+    {
+        statsAdd(&LogFilteredCount, 1);
+    }
+
+    return retVal;
+}
+
+eStatus LogSetLevel(const eLogLevel level)
+{
+    eStatus retVal = eINVALIDARG;
+
+    if (level < eLogLevelCount)
+    {
+        LogCurrentLevel = level;
+        retVal = eOK;
+    }
+    else
+    {
+        Log(eLogWarn, CMP_NAME, "Invalid log level: %d", level);
+    }
+
+    return retVal;
+}
+
+// The dump goes into the ring as raw bytes, a single record unless it doesn't
+// fit LOG_MAX_RECORD_SIZE. A larger one takes several records, all of them
+// reserved before any is committed, so that it makes it in whole or not at
+// all. One larger than a ring can hold at once is logged in parts, each of
+// them whole on its own. LogTask() renders it as hex, for text sinks only
+eStatus LogDumpBuffer(const eLogLevel level, const char * const component, const char * const function, const uint8_t * const buffer, size_t buffer_size)
+{
+    eStatus retVal = eOK;
+
+    if (!initialized)
+    {
+        retVal = eNOTINITIALIZED;
+    }
+    else if (LogPortInISR())
+    {
+        retVal = eUNSUPPORTED;
+    }
+    else if ((level >= eLogLevelCount) || ((NULL == buffer) && (buffer_size > 0)))
+    {
+        retVal = eINVALIDARG;
+    }
+    else if (level < LogCurrentLevel)
+    {
+        statsAdd(&LogFilteredCount, 1);
+    }
+    else
+    {
+        LogRing * const ring = producerRing();
+        LogDumpHeader header;
+        uint8_t timeString[LOG_TIME_STRING_MAX];
+        const size_t timeLength = putTimeString(timeString);
+        const size_t prefix = sizeof(header) + timeLength;
+        const size_t perRecord = LOG_MAX_RECORD_SIZE - prefix;
+        // as many whole records as an empty ring takes
+        const size_t perPart = perRecord * ((LOG_RING_SIZE - dumpPartSpace(0, prefix, perRecord)) /
+                (perRecord + LOG_RING_HEADER_SIZE + sizeof(uint32_t) + prefix + LOG_RING_ALIGN));
+        const size_t parts = (buffer_size > 0) ? (((buffer_size - 1) / perPart) + 1) : 1;
+
+        header.Level = (uint8_t)level;
+        header.TimeLength = (uint8_t)timeLength;
+        header.Time = LogPortGetTimeMs();
+        header.Component = component;
+        header.Function = function;
+        header.Total = (uint32_t)buffer_size;
+        header.Parts = (uint16_t)parts;
+
+        // tens of MB even with the smallest rings, counted like any drop
+        if (parts > UINT16_MAX)
+        {
+            retVal = eINVALIDARG;
+            statsAdd(&droppedCount, 1);
+            statsAdd(&logStats.MessagesDropped, 1);
+        }
+
+        for (size_t part = 0; (eOK == retVal) && (part < parts); part++)
+        {
+            const size_t offset = part * perPart;
+            const size_t size = (part < (parts - 1)) ? perPart : (buffer_size - offset);
+
+            // the ring is likely still full of the parts before
+            if (part > 0)
+            {
+                waitForSpace(ring, dumpPartSpace(size, prefix, perRecord));
+            }
+
+            header.Part = (uint16_t)(part + 1);
+            retVal = logDumpPart(ring, &header, timeString, buffer, offset, size, perRecord);
+        }
+    }
+
+    return retVal;
+}
+
+// Snapshot of the counters. They are updated without locking, so the snapshot
+// is not guaranteed to be consistent across fields
+eStatus LogGetStats(LogStats * const stats)
+{
+    eStatus retVal = eOK;
+
+    if (NULL == stats)
+    {
+        retVal = eINVALIDARG;
+    }
+    else
+    {
+        memcpy(stats, (const void *)&logStats, sizeof(*stats));
+        stats->MessagesFiltered = LogFilteredCount;
+        stats->BufferSize = LOG_RING_SIZE;
+        stats->SinkCount = 0;
+        for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+        {
+            if (eLogSinkActive == __atomic_load_n(&sinkSlots[i].State, __ATOMIC_ACQUIRE))
+            {
+                LogSinkStats * const sinkStats = &stats->Sinks[stats->SinkCount++];
+
+                *sinkStats = logStats.Sinks[i];
+                sinkStats->Name = sinkSlots[i].Sink->Name;
+                sinkStats->Lag = 0;
+                for (size_t r = 0; r < LOG_RING_COUNT; r++)
+                {
+                    sinkStats->Lag += __atomic_load_n(&ringAt(r)->Head, __ATOMIC_RELAXED) - sinkCursors[i].Position[r];
+                }
+            }
+        }
+    }
+
+    return retVal;
+}
+
+// Counter by counter, each cleared atomically, as producers may be counting
+// meanwhile. What they count during the reset may land on either side of it
+eStatus LogResetStats(void)
+{
+    uint32_t * const counters[] = {
+        &logStats.MessagesAccepted, &logStats.MessagesDropped, &logStats.MessagesEvicted,
+        &logStats.MessagesTruncated, &logStats.BytesEnqueued, &logStats.BlockTimeouts,
+        &logStats.BlockWaitTime, &logStats.BufferHighWater, (uint32_t *)&LogFilteredCount,
+    };
+
+    for (size_t i = 0; i < (sizeof(counters) / sizeof(counters[0])); i++)
+    {
+        __atomic_store_n(counters[i], 0, __ATOMIC_RELAXED);
+    }
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+    {
+        __atomic_store_n(&logStats.Sinks[i].BytesWritten, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&logStats.Sinks[i].WriteErrors, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&logStats.Sinks[i].MessagesDropped, 0, __ATOMIC_RELAXED);
+    }
+
+    return eOK;
+}
+
+// Safe while LogTask() runs, which takes the sink on at the start of its next
+// round, beginning with whatever is still in the buffer. sink must stay valid
+// until it's removed
+eStatus LogAddSink(const LogSink * const sink)
+{
+    eStatus retVal = eOK;
+
+    if (!initialized)
+    {
+        retVal = eNOTINITIALIZED;
+    }
+    else
+    {
+        retVal = addSink(sink);
+    }
+
+    return retVal;
+}
+
+// LogTask() lets go of the sink at the start of its next round - a round
+// already under way may still write to it
+eStatus LogRemoveSink(const LogSink * const sink)
+{
+    eStatus retVal = eINVALIDARG;
+
+    for (size_t i = 0; (eOK != retVal) && (NULL != sink) && (i < LOG_MAX_SINKS); i++)
+    {
+        eLogSinkState expected = __atomic_load_n(&sinkSlots[i].State, __ATOMIC_ACQUIRE);
+        if ((sink == sinkSlots[i].Sink) && ((eLogSinkAdded == expected) || (eLogSinkActive == expected)) &&
+            __atomic_compare_exchange_n(&sinkSlots[i].State, &expected, eLogSinkRemoved, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+            retVal = eOK;
+        }
+    }
+
+    if (eOK == retVal)
+    {
+        wakeConsumer();
+    }
+
+    return retVal;
+}
+
+// Messages below level are skipped for the sink, below LogCurrentLevel they
+// don't get anywhere in the first place. Best set right after LogAddSink()
+eStatus LogSetSinkLevel(const LogSink * const sink, const eLogLevel level)
+{
+    eStatus retVal = eOK;
+    const size_t slot = findSink(sink);
+
+    if ((LOG_MAX_SINKS == slot) || (level >= eLogLevelCount))
+    {
+        retVal = eINVALIDARG;
+    }
+    else
+    {
+        sinkSlots[slot].Level = level;
+    }
+
+    return retVal;
+}
+
+// Takes effect with the next message, eLogSinkFormat flags
+eStatus LogSetSinkFormat(const LogSink * const sink, const uint32_t format)
+{
+    eStatus retVal = eOK;
+    const size_t slot = findSink(sink);
+
+    if ((LOG_MAX_SINKS == slot) || (0 != (format & ~(uint32_t)(eLogSinkFormatAll | eLogSinkFormatCompress))))
+    {
+        retVal = eINVALIDARG;
+    }
+    else if ((0 == LOG_COMPRESS) && (0 != (format & eLogSinkFormatCompress)))
+    {
+        retVal = eUNSUPPORTED;
+    }
+    else
+    {
+        sinkSlots[slot].Format = format;
+    }
+
+    return retVal;
+}
+
+eStatus LogInit(void * params)
+{
+    eStatus retVal = eOK;
+
+    if (NULL != params)
+    {
+        const LogInitParams * const initParams = (const LogInitParams *)params;
+        overflowPolicy = initParams->OverflowPolicy;
+        blockTimeout = initParams->BlockTimeout;
+    }
+
+    LogCurrentLevel = LOG_LEVEL_DEFAULT;   // default log level
+
+    retVal = LogPortInit();
+
+    if (eOK == retVal)
+    {
+        for (size_t i = 0; (i < LOG_BUFFER_COUNT) && (eOK == retVal); i++)
+        {
+            retVal = LogRingInit(&logRings[i], logBufferStorage[i], LOG_RING_SIZE);
+        }
+    }
+
+    if (eOK == retVal)
+    {
+        retVal = LogRingInit(&logIsrRing, logIsrBufferStorage, LOG_ISR_BUFFER_SIZE);
+    }
+
+    if (eOK == retVal)
+    {
+        initialized = true;
+    }
+    else
+    {
+        Log(eLogWarn, CMP_NAME, "LogInit: Error creating log buffer!");
+    }
+
+    // Without its default sink the logger still works, sinks added later get
+    // what was logged meanwhile. The failure is reported all the same
+    if (initialized)
+    {
+        retVal = addSink(&LOG_SINK_DEFAULT);
+        if (eOK != retVal)
+        {
+            Log(eLogWarn, CMP_NAME, "LogInit: Error initializing %s sink", LOG_SINK_DEFAULT.Name);
+        }
+
+        // LogTask() isn't running yet, the sink gets every message from the
+        // first one on
+        updateSinks();
+    }
+
+    return retVal;
+}
+
+// A round over all sinks. Sinks out of room are retried every
+// LOG_SINK_RETRY_INTERVAL ms, new messages for the others go out right away.
+// Sinks that buffer are flushed LOG_SINK_FLUSH_INTERVAL ms after the first
+// write since their last flush at the latest
+eStatus LogTask(void)
+{
+    const size_t flushWait = nextFlush();
+
+    __atomic_store_n(&consumerTask, LogPortGetTaskId(), __ATOMIC_RELAXED);
+
+    if (sinksStalled)
+    {
+        waitForRecord(MIN(flushWait, (size_t)LOG_SINK_RETRY_INTERVAL), true);
+    }
+    else
+    {
+        waitForRecord(flushWait, false);
+    }
+#if (LOG_BATCH_SIZE > 0)
+    waitForBatch();
+#endif // LOG_BATCH_SIZE
+
+    // lost before they got into the buffer, so to every sink
+    const uint32_t dropped = __atomic_exchange_n(&droppedCount, 0, __ATOMIC_RELAXED);
+
+    updateSinks();
+    skipLagging();
+    sinksStalled = false;
+    for (size_t i = 0; i < LOG_MAX_SINKS; i++)
+    {
+        if (sinkLive(i))
+        {
+            statsAdd(&sinkCursors[i].Dropped, dropped);
+            sinksStalled = drainSink(i) || sinksStalled;
+        }
     }
+    reclaimSpace();
+    flushDue();
 
     return eOK; // Always running
 }
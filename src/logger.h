@@ -50,8 +50,45 @@ extern "C"
 #endif // DEBUG
 #endif // LOG_LEVEL_DEFAULT
 
-#define LOG(level, ...)             Log((level), CMP_NAME, __func__, __VA_ARGS__)
-#define LOG_DUMP_BUFFER(level, ...) LogDumpBuffer((level), CMP_NAME, __func__, __VA_ARGS__)
+// Capacity of the sink registry, see LogAddSink()
+#if !defined(LOG_MAX_SINKS)
+#define LOG_MAX_SINKS               4
+#endif // LOG_MAX_SINKS
+
+// Compile-time level floor: LOG() calls below it compile to nothing - their
+// arguments are not evaluated and their format strings are not stored. Calls
+// at or above it are still subject to LogSetLevel()
+#if !defined(LOG_LEVEL_COMPILE_MIN)
+#define LOG_LEVEL_COMPILE_MIN       eLogTrace
+#endif // LOG_LEVEL_COMPILE_MIN
+
+// The level is checked inline before any argument is evaluated. The floor is
+// repeated here so that it folds away even in unoptimized builds. Messages
+// below the runtime level are counted, those below the floor are compiled out
+#define LOG(level, ...)             (((level) >= LOG_LEVEL_COMPILE_MIN) ? (LogEnabled(level) ? \
+                                        Log((level), CMP_NAME, __func__, __VA_ARGS__) : LogFiltered()) : eOK)
+#define LOG_DUMP_BUFFER(level, ...) (((level) >= LOG_LEVEL_COMPILE_MIN) ? (LogEnabled(level) ? \
+                                        LogDumpBuffer((level), CMP_NAME, __func__, __VA_ARGS__) : LogFiltered()) : eOK)
+
+// ISR-safe logging: integer arguments only (%d %u %x %X %c, no length
+// modifiers), at most LOG_ISR_MAX_ARGS of them. The format string is kept by
+// pointer, so it must be a literal. Rendered later by LogTask()
+#define LOG_ISR_MAX_ARGS            4
+#define LOG_ISR(level, format, ...) (((level) >= LOG_LEVEL_COMPILE_MIN) ? (LogEnabled(level) ? \
+                                        LogFromISR((level), CMP_NAME, __func__, (format), \
+                                                LOG_ISR_ARG_COUNT(__VA_ARGS__), ##__VA_ARGS__) : LogFiltered()) : eOK)
+// Counts up to 16 arguments. 5 to 16 of them select an identifier that is
+// never declared, so passing too many fails to compile
+#define LOG_ISR_ARG_COUNT(...)      LOG_ISR_ARG_COUNT_(0, ##__VA_ARGS__, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        LOG_ISR_TOO_MANY_ARGUMENTS, LOG_ISR_TOO_MANY_ARGUMENTS, \
+                                        4, 3, 2, 1, 0)
+#define LOG_ISR_ARG_COUNT_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, \
+                                        _13, _14, _15, _16, n, ...) n
 
 //==============================================================================
 //  Exported types
@@ -69,11 +106,74 @@ typedef enum _eLogLevel
     eLogLevelCount,
 } eLogLevel;
 
+// What Log() does when the log buffer has no room for a message. Messages are
+// always kept whole - a message either makes it in completely or not at all.
+// eLogOverflowOverwriteOldest can only evict committed messages: while the
+// oldest one is still being logged by another task, new ones are dropped
+typedef enum _eLogOverflowPolicy
+{
+    eLogOverflowDropNewest,         // drop the new message, return eBUSY
+    eLogOverflowBlock,              // wait up to BlockTimeout ms for room, then drop it
+    eLogOverflowOverwriteOldest,    // evict the oldest messages to make room
+} eLogOverflowPolicy;
+
+// Optional LogInit() parameters, NULL selects the defaults: drop newest
+typedef struct _LogInitParams
+{
+    eLogOverflowPolicy      OverflowPolicy;
+    size_t                  BlockTimeout;   // ms, eLogOverflowBlock only
+} LogInitParams;
+
+// How a sink renders messages, see LogSetSinkFormat(). The header fields come
+// in this order, each followed by '|', the function name by ':'
+typedef enum _eLogSinkFormat
+{
+    eLogSinkFormatColor         = 0x01,     // ANSI color by level, if LOG_USE_COLOR
+    eLogSinkFormatTimeString    = 0x02,     // LogPortTimeGetString()
+    eLogSinkFormatTime          = 0x04,     // ms since boot
+    eLogSinkFormatLevel         = 0x08,
+    eLogSinkFormatComponent     = 0x10,
+    eLogSinkFormatFunction      = 0x20,
+    eLogSinkFormatAll           = 0x3f,
+    eLogSinkFormatCompress      = 0x40,     // batches as log_compress frames, needs LOG_COMPRESS
+} eLogSinkFormat;
+
+typedef struct _LogSinkStats
+{
+    const char *            Name;
+    uint32_t                BytesWritten;
+    uint32_t                WriteErrors;    // writes that came back short
+    uint32_t                MessagesDropped;    // skipped for falling behind, or evicted before written
+    uint32_t                Lag;            // bytes in the buffer not written to the sink yet
+} LogSinkStats;
+
+// Runtime counters, see LogGetStats(). All of them are 32-bit and wrap
+typedef struct _LogStats
+{
+    uint32_t                MessagesAccepted;   // made it into the log buffer
+    uint32_t                MessagesFiltered;   // below the runtime level, from the macros or Log()
+    uint32_t                MessagesDropped;    // lost to a full buffer, whatever the policy
+    uint32_t                MessagesEvicted;    // of the above, evicted by eLogOverflowOverwriteOldest
+    uint32_t                MessagesTruncated;  // cut short at LOG_MAX_RECORD_SIZE
+    uint32_t                BytesEnqueued;
+    uint32_t                BlockTimeouts;      // eLogOverflowBlock waits that ran out
+    uint32_t                BlockWaitTime;      // ms spent waiting by eLogOverflowBlock, in total
+    uint32_t                BufferHighWater;    // bytes, of the fullest ring
+    uint32_t                BufferSize;         // bytes, per ring
+    size_t                  SinkCount;
+    LogSinkStats            Sinks[LOG_MAX_SINKS];
+} LogStats;
+
 // Function pointers to different log sinks. Would've been cleaner with an
 // interface, but I want to keep it as C as possible
+// GetWriteSize is how much the sink takes right now without blocking, 0 if
+// nothing. Every sink is drained at its own pace, a slow one doesn't hold up
+// the others
 typedef eStatus (*LogSinkInitFn)(void);
 typedef size_t  (*LogSinkGetWriteSizeFn)(void);
 typedef size_t  (*LogSinkWriteFn)(const uint8_t * const buffer, const size_t toSend);
+// Pushes out whatever the sink holds back, called by LogTask() only
+typedef void    (*LogSinkFlushFn)(void);
 
 typedef struct _LogSink
 {
@@ -81,24 +181,54 @@ typedef struct _LogSink
     LogSinkInitFn           Init;
     LogSinkGetWriteSizeFn   GetWriteSize;
     LogSinkWriteFn          Write;
+    LogSinkFlushFn          Flush;          // optional, for sinks that buffer
 } LogSink;
 
 //==============================================================================
 //  Exported data
 //==============================================================================
+// Runtime level, exported only for LogEnabled() - change it via LogSetLevel().
+// Aligned word-sized loads are atomic on all supported targets
+extern volatile eLogLevel LogCurrentLevel;
+// Exported only for LogFiltered(), read it through LogGetStats()
+extern volatile uint32_t LogFilteredCount;
 
 //==============================================================================
 //  Exported functions
 //==============================================================================
 eStatus Log(const eLogLevel level, const char * const component, const char * const function, ...);
+eStatus LogFromISR(const eLogLevel level, const char * const component, const char * const function, const char * const format, const size_t argCount, ...);
 eStatus LogSetLevel(const eLogLevel level);
 eStatus LogDumpBuffer(const eLogLevel level, const char * const component, const char * const function, const uint8_t * const buffer, size_t buffer_size);
-const char * LogPortTimeGetString();    // logger_port contains a __weak implementation, user can override
+eStatus LogGetStats(LogStats * const stats);
+eStatus LogResetStats(void);
+eStatus LogAddSink(const LogSink * const sink);
+eStatus LogRemoveSink(const LogSink * const sink);
+eStatus LogSetSinkLevel(const LogSink * const sink, const eLogLevel level);
+eStatus LogSetSinkFormat(const LogSink * const sink, const uint32_t format);   // eLogSinkFormat flags
+// logger_port contains a __weak implementation, user can override. It is called
+// by every logging task, on any core, at the same time, so an override has to
+// be reentrant - a static buffer rewritten on every call can be read torn
+const char * LogPortTimeGetString();
+
+// Fast path for filtered-out messages: a load and a compare, no call. Also
+// handy to guard expensive preparation of log arguments
+static inline bool LogEnabled(const eLogLevel level)
+{
+    return ((level >= LOG_LEVEL_COMPILE_MIN) && (level >= LogCurrentLevel));
+}
+
+// What the macros do with a message below the runtime level: count it
+static inline eStatus LogFiltered(void)
+{
+    __atomic_add_fetch(&LogFilteredCount, 1, __ATOMIC_RELAXED);
+    return eOK;
+}
 
 //==============================================================================
 //  Module generic interface
 //==============================================================================
-eStatus LogInit(void * params);
+eStatus LogInit(void * params);        // LogInitParams * or NULL
 eStatus LogTask(void);
 
 #ifdef __cplusplus
@@ -22,16 +22,21 @@
    SOFTWARE.
   ============================================================================*/
 
+// FreeRTOS/Arduino port - host builds use logger_port_posix.cpp instead
+#if !defined(LOG_PORT_POSIX)
+
 //==============================================================================
 //  Includes
 //==============================================================================
 #include <globals.h>
+#include "logger.h"
 #include "logger_port.h"
 
 //==============================================================================
 //  Defines
 //==============================================================================
-#define PortGetTime()       (xTaskGetTickCount() * portTICK_PERIOD_MS)
+#define PortGetTicks()      (LogPortInISR() ? xTaskGetTickCountFromISR() : xTaskGetTickCount())
+#define PortGetTime()       (PortGetTicks() * portTICK_PERIOD_MS)
 
 //==============================================================================
 //  Local types
@@ -41,7 +46,7 @@
 //  Local data
 //==============================================================================
 static SemaphoreHandle_t    LogSemaphore;
-static char                 timeBuffer[32];
+static portMUX_TYPE         LogMux = portMUX_INITIALIZER_UNLOCKED;
 
 //==============================================================================
 //  Local functions
@@ -52,21 +57,63 @@ static char                 timeBuffer[32];
 //  Exported functions
 //==============================================================================
 
-bool LogPortLock(size_t waitTime)
+bool LogPortWait(size_t waitTime)
+{
+    TickType_t ticks = (LOG_PORT_WAIT_FOREVER == waitTime) ? portMAX_DELAY : (waitTime / portTICK_PERIOD_MS);
+    return ((xSemaphoreTake(LogSemaphore, ticks) == pdTRUE) ? true : false);
+}
+
+LOG_PORT_ISR_ATTR void LogPortSignal()
+{
+    if (LogPortInISR())
+    {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(LogSemaphore, &woken);
+        if (pdTRUE == woken)
+        {
+            portYIELD_FROM_ISR();
+        }
+    }
+    else
+    {
+        xSemaphoreGive(LogSemaphore);
+    }
+}
+
+void LogPortDelay(size_t ms)
+{
+    vTaskDelay(MAX(ms / portTICK_PERIOD_MS, (size_t)1));
+}
+
+LOG_PORT_ISR_ATTR void LogPortLock()
 {
-    return ((xSemaphoreTake(LogSemaphore, waitTime / portTICK_PERIOD_MS) == pdTRUE) ? true : false);
+    if (LogPortInISR())
+    {
+        portENTER_CRITICAL_ISR(&LogMux);
+    }
+    else
+    {
+        portENTER_CRITICAL(&LogMux);
+    }
 }
 
-void LogPortUnlock()
+LOG_PORT_ISR_ATTR void LogPortUnlock()
 {
-    xSemaphoreGive(LogSemaphore);
+    if (LogPortInISR())
+    {
+        portEXIT_CRITICAL_ISR(&LogMux);
+    }
+    else
+    {
+        portEXIT_CRITICAL(&LogMux);
+    }
 }
 
 eStatus LogPortInit()
 {
     eStatus retVal = eOK;
 
-    LogSemaphore = xSemaphoreCreateMutex();
+    LogSemaphore = xSemaphoreCreateBinary();
 
     if (NULL == LogSemaphore)
     {
@@ -76,13 +123,19 @@ eStatus LogPortInit()
     return retVal;
 }
 
-const char * LogPortGetTime()
+LOG_PORT_ISR_ATTR uint32_t LogPortGetTimeMs()
+{
+    return PortGetTime();
+}
+
+LOG_PORT_ISR_ATTR uint32_t LogPortGetTimestamp()
 {
-    snprintf((char *)timeBuffer, sizeof(timeBuffer), "%09d", PortGetTime());
-    return timeBuffer;
+    return (uint32_t)micros();
 }
 
 __attribute__ ((weak)) const char * LogPortTimeGetString()
 {
     return "";
 }
+
+#endif // !LOG_PORT_POSIX
@@ -24,21 +24,57 @@
    SOFTWARE.
   ============================================================================*/
 
-// No multi-include guard - this file is supposed to be include by logger.c only
+// No multi-include guard - this file is supposed to be include by the logger's
+// own modules only
 
 //==============================================================================
 //  Multi-include guard
 //==============================================================================
 
+#if defined(LOG_PORT_POSIX)
+#include <pthread.h>
+#include <stdint.h>
+#else
 #include <Arduino.h>
+#endif // LOG_PORT_POSIX
 #include <globals.h>
 
 //==============================================================================
 //  Defines
 //==============================================================================
 
+#if defined(LOG_PORT_POSIX)
+// Host build - pthreads and the monotonic clock, see logger_port_posix.cpp.
+// There are no interrupts and threads migrate between CPUs freely, so all of
+// them share a single ring
+#define LogPortInISR()      (false)
+#define LogPortGetCoreId()  (0)
+#define LogPortGetTaskId()  ((uintptr_t)pthread_self())
+
+#define LOG_PORT_CORE_COUNT     1
+
+#define LOG_PORT_ISR_ATTR
+#define LOG_PORT_NOINIT_ATTR
+
+#else
 // FreeRTOS provided functionality
 #define LogPortInISR()      xPortInIsrContext()
+#define LogPortGetCoreId()  xPortGetCoreID()
+#define LogPortGetTaskId()  ((uintptr_t)xTaskGetCurrentTaskHandle())
+
+#define LOG_PORT_CORE_COUNT     portNUM_PROCESSORS
+
+// Code reachable from LogFromISR() stays in IRAM, so that it keeps working
+// from handlers that run while the flash cache is disabled
+#define LOG_PORT_ISR_ATTR       IRAM_ATTR
+
+// Left alone by the startup code, so it keeps its contents across software
+// resets, panics and watchdog resets - not across power cycles
+#define LOG_PORT_NOINIT_ATTR    __NOINIT_ATTR
+#endif // LOG_PORT_POSIX
+
+#define LOG_PORT_WAIT_FOREVER   ((size_t)-1)
+#define LOG_PORT_TIME_DIGITS    9           // zero-padded to this many digits
 
 //==============================================================================
 //  Exported types
@@ -52,6 +88,12 @@
 //  Exported functions
 //==============================================================================
 eStatus         LogPortInit(void);
-bool            LogPortLock(size_t waitTime);
+bool            LogPortWait(size_t waitTime);
+void            LogPortSignal(void);
+void            LogPortDelay(size_t ms);
+// Short critical section, safe from tasks and ISRs alike. Keep it to a few
+// memory operations - on FreeRTOS it masks interrupts
+void            LogPortLock(void);
 void            LogPortUnlock(void);
-const char *    LogPortGetTime(void);
+uint32_t        LogPortGetTimeMs(void);
+uint32_t        LogPortGetTimestamp(void);      // us, wraps - for ordering only
@@ -0,0 +1,166 @@
+/*==============================================================================
+   zLogger - Flexible logging library for ESP32
+
+   Copyright 2020-2026 Ivan Vasilev, Zmei Research Ltd.
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+   SOFTWARE.
+  ============================================================================*/
+
+// POSIX port for host builds and benchmarks, selected with LOG_PORT_POSIX
+#if defined(LOG_PORT_POSIX)
+
+//==============================================================================
+//  Includes
+//==============================================================================
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <globals.h>
+#include "logger.h"
+#include "logger_port.h"
+
+//==============================================================================
+//  Defines
+//==============================================================================
+#define NS_PER_MS           1000000ULL
+#define NS_PER_US           1000ULL
+#define NS_PER_S            1000000000ULL
+
+//==============================================================================
+//  Local types
+//==============================================================================
+
+//==============================================================================
+//  Local data
+//==============================================================================
+
+// Binary semaphore equivalent - a flag guarded by a mutex
+static pthread_mutex_t      portMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       portCond;
+static bool                 portSignaled = false;
+
+static pthread_mutex_t      portLock = PTHREAD_MUTEX_INITIALIZER;
+
+//==============================================================================
+//  Local functions
+//==============================================================================
+static uint64_t portGetTimeNs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * NS_PER_S) + (uint64_t)now.tv_nsec;
+}
+
+//==============================================================================
+//  Exported functions
+//==============================================================================
+
+bool LogPortWait(size_t waitTime)
+{
+    bool retVal;
+    int result = 0;
+
+    pthread_mutex_lock(&portMutex);
+
+    if (LOG_PORT_WAIT_FOREVER == waitTime)
+    {
+        while (!portSignaled)
+        {
+            pthread_cond_wait(&portCond, &portMutex);
+        }
+    }
+    else
+    {
+        const uint64_t deadlineNs = portGetTimeNs() + ((uint64_t)waitTime * NS_PER_MS);
+        struct timespec deadline;
+
+        deadline.tv_sec = (time_t)(deadlineNs / NS_PER_S);
+        deadline.tv_nsec = (long)(deadlineNs % NS_PER_S);
+
+        while (!portSignaled && (0 == result))
+        {
+            result = pthread_cond_timedwait(&portCond, &portMutex, &deadline);
+        }
+    }
+
+    retVal = portSignaled;
+    portSignaled = false;
+
+    pthread_mutex_unlock(&portMutex);
+
+    return retVal;
+}
+
+void LogPortSignal()
+{
+    pthread_mutex_lock(&portMutex);
+    portSignaled = true;
+    pthread_cond_signal(&portCond);
+    pthread_mutex_unlock(&portMutex);
+}
+
+void LogPortDelay(size_t ms)
+{
+    usleep(MAX(ms, (size_t)1) * 1000);
+}
+
+void LogPortLock()
+{
+    pthread_mutex_lock(&portLock);
+}
+
+void LogPortUnlock()
+{
+    pthread_mutex_unlock(&portLock);
+}
+
+eStatus LogPortInit()
+{
+    eStatus retVal = eOK;
+    pthread_condattr_t attr;
+
+    // deadlines are computed from CLOCK_MONOTONIC, the condition must use it too
+    if ((0 != pthread_condattr_init(&attr)) ||
+        (0 != pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) ||
+        (0 != pthread_cond_init(&portCond, &attr)))
+    {
+        retVal = eFAILED;
+    }
+
+    return retVal;
+}
+
+uint32_t LogPortGetTimeMs()
+{
+    return (uint32_t)(portGetTimeNs() / NS_PER_MS);
+}
+
+uint32_t LogPortGetTimestamp()
+{
+    return (uint32_t)(portGetTimeNs() / NS_PER_US);
+}
+
+__attribute__ ((weak)) const char * LogPortTimeGetString()
+{
+    return "";
+}
+
+#endif // LOG_PORT_POSIX